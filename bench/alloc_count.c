@@ -0,0 +1,104 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alloc_count.h"
+
+#line __LINE__ "alloc_count.c"
+
+/* the allocator glibc itself uses when malloc() is replaced */
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+static uint64_t allocations = 0;
+static uint64_t reallocations = 0;
+static uint64_t frees = 0;
+
+static inline void
+count(uint64_t *counter) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+void *
+malloc(size_t size) {
+    count(&allocations);
+
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t count_, size_t size) {
+    count(&allocations);
+
+    return __libc_calloc(count_, size);
+}
+
+void *
+realloc(void *ptr, size_t size) {
+    count(ptr == NULL ? &allocations : &reallocations);
+
+    return __libc_realloc(ptr, size);
+}
+
+void *
+memalign(size_t alignment, size_t size) {
+    count(&allocations);
+
+    return __libc_memalign(alignment, size);
+}
+
+void *
+aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int
+posix_memalign(void **ptr, size_t alignment, size_t size) {
+    void *p = memalign(alignment, size);
+
+    if (p == NULL) {
+        return ENOMEM;
+    }
+
+    *ptr = p;
+
+    return 0;
+}
+
+void
+free(void *ptr) {
+    if (ptr != NULL) {
+        count(&frees);
+    }
+
+    __libc_free(ptr);
+}
+
+void
+alloc_count_get(alloc_count_t *result) {
+    result->allocations = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+    result->reallocations = __atomic_load_n(&reallocations, __ATOMIC_RELAXED);
+    result->frees = __atomic_load_n(&frees, __ATOMIC_RELAXED);
+}
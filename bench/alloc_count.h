@@ -0,0 +1,46 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_ALLOC_COUNT_H_
+#define HEDIS_CONNECTOR_ALLOC_COUNT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * Counts the heap allocations of the whole process, libc and C++ runtime
+ * included, by interposing malloc() and its siblings over those of glibc.
+ * Linking alloc_count.c in is enough; the counters cost one relaxed atomic
+ * add per call.
+ */
+typedef struct alloc_count_t_ {
+    uint64_t allocations;       /* malloc, calloc, realloc of NULL, memalign */
+    uint64_t reallocations;
+    uint64_t frees;             /* of non-NULL pointers */
+} alloc_count_t;
+
+void
+alloc_count_get(alloc_count_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_ALLOC_COUNT_H_ */
@@ -0,0 +1,159 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../command.h"
+
+#line __LINE__ "command_bench.c"
+
+/*
+ * Checks the command tokenizer against the POSIX regex it replaced and
+ * measures both, plus the plan cache lookup on top of the tokenizer.
+ */
+
+// the pattern get_value() used to run on every lookup
+#define LEGACY_PATTERN "^([a-zA-Z0-9_\\-]+)@([#:,a-zA-Z0-9_\\\\\\-]+)(@([@#a-zA-Z0-9_\\\\\\-]+)(:([a-zA-Z0-9_\\-]+))?)?"
+#define LEGACY_GROUPS 7
+
+#define ITERATIONS 5000000
+
+static const char *commands[] = {
+    "user@kewang",
+    "user@kewang@cf",
+    "user@kewang@cf:nk",
+    "user@kewang,john,mary@cf:nk",
+    "user_2@row#1:a\\b@f@m#:q-1",
+    "order-history@2016-01-01#0042@d:total",
+    "user@kewang@cf:",
+    "user@kewang@",
+    "user@kewang trailing",
+    "user@",
+    "@kewang",
+    "user",
+    "",
+};
+
+static double
+now_seconds() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+same_group(const char *str, const regmatch_t *m, const char *field, size_t len) {
+    if (m->rm_so == -1) {
+        return field == NULL;
+    }
+
+    return field != NULL && field == str + m->rm_so && len == (size_t) (m->rm_eo - m->rm_so);
+}
+
+static void
+check(regex_t *regex) {
+    size_t count = sizeof(commands) / sizeof(commands[0]);
+
+    for (size_t i = 0; i < count; i++) {
+        const char *str = commands[i];
+        regmatch_t m[LEGACY_GROUPS];
+        hedis_command_t command;
+        int matched = regexec(regex, str, LEGACY_GROUPS, m, 0) == 0;
+        int parsed = hedis_command_parse(str, &command) == 0;
+
+        if (matched != parsed
+            || (parsed && (!same_group(str, &m[1], command.table, command.table_len)
+                           || !same_group(str, &m[2], command.rowkey, command.rowkey_len)
+                           || !same_group(str, &m[4], command.family, command.family_len)
+                           || !same_group(str, &m[6], command.qualifier, command.qualifier_len)))) {
+            fprintf(stderr, "FAILED: \"%s\" parses differently from the regex\n", str);
+            exit(1);
+        }
+    }
+
+    printf("check: %zu commands match the regex\n", count);
+}
+
+static void
+report(const char *name, double elapsed) {
+    printf("%-16s %12.0f commands/s %8.1f ns/command\n",
+           name, ITERATIONS / elapsed, elapsed * 1e9 / ITERATIONS);
+}
+
+int
+main() {
+    regex_t regex;
+    size_t sink = 0;
+
+    if (regcomp(&regex, LEGACY_PATTERN, REG_EXTENDED | REG_NEWLINE) != 0) {
+        fprintf(stderr, "could not compile the legacy pattern\n");
+        return 1;
+    }
+
+    check(&regex);
+
+    double start = now_seconds();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        regmatch_t m[LEGACY_GROUPS];
+
+        if (regexec(&regex, commands[i % 6], LEGACY_GROUPS, m, 0) == 0) {
+            sink += m[2].rm_eo;
+        }
+    }
+
+    report("regexec", now_seconds() - start);
+
+    start = now_seconds();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        hedis_command_t command;
+
+        if (hedis_command_parse(commands[i % 6], &command) == 0) {
+            sink += command.rowkey_len;
+        }
+    }
+
+    report("parse", now_seconds() - start);
+
+    start = now_seconds();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        hedis_command_t command;
+
+        if (hedis_command_parse(commands[i % 6], &command) == 0) {
+            const command_plan_t *plan = command_plan_acquire(&command);
+
+            sink += plan->table_len;
+            command_plan_release(plan);
+        }
+    }
+
+    report("parse + plan", now_seconds() - start);
+
+    regfree(&regex);
+
+    return sink == 0;
+}
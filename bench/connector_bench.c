@@ -0,0 +1,417 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../hedis.h"
+#include "alloc_count.h"
+#include "mock_hbase.h"
+
+#line __LINE__ "connector_bench.c"
+
+/*
+ * Drives the connector, linked against the mock client of mock_hbase.c, and
+ * reports throughput, latency percentiles and heap allocations per operation
+ * of single gets, multi-gets, scans, writes and gets from many concurrent
+ * callers. Allocations are counted over the whole process, the mock client
+ * included, by bench/alloc_count.c.
+ *
+ * usage: connector_bench [-l latency_us] [-j jitter_us] [-t callback_threads]
+ *                        [-c columns] [-v value_size] [-r locate_us]
+ *                        [-d stall_us] [-p stall_per_mille] [-m miss_percent]
+ *                        [-n operations] [-s] [setting=value ...]
+ *
+ * Settings are passed to init() as they are, e.g. cache_max_entries=10000.
+ * -r makes the first request of each client to a table pay for a region
+ * lookup, which warmup_tables=bench moves into init(). -d and -p make
+ * 'stall_per_mille' requests out of 1000 take 'stall_us' longer, the tail
+ * that request_timeout_ms and hedge_percentile cut. -m sets the share of
+ * missing rows among the rowkeys that the repeated gets cycle through, for
+ * miss_filter_bytes and miss_exact_entries. -s prints the connector
+ * statistics at the end.
+ */
+
+#define MAX_CALLERS 64
+#define MULTI_GET_ROWS 10
+#define SCAN_ROWS 1000
+#define REPEAT_ROWS 1000
+
+int init(hedisConfigEntry **entries, int entry_count);
+
+typedef struct caller_t_ {
+    pthread_t thread;
+    int id;
+    int operations;
+    int (*run)(int id, int i);
+    uint64_t *latencies;
+    int failures;
+} caller_t;
+
+static int operations = 2000;
+static int miss_percent = 50;
+
+static uint64_t
+now_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int
+run_get(int id, int i) {
+    char command[64];
+
+    snprintf(command, sizeof(command), "bench@user%d_%d@cf:q0", id, i);
+
+    char *value = get_value(command);
+    int ok = value != NULL;
+
+    free(value);
+
+    return ok;
+}
+
+static int
+run_wide_get(int id, int i) {
+    char command[64];
+
+    snprintf(command, sizeof(command), "bench@user%d_%d", id, i);
+
+    char *value = get_value(command);
+    int ok = value != NULL;
+
+    free(value);
+
+    return ok;
+}
+
+/* gets cycling through REPEAT_ROWS rowkeys, 'miss_percent' of them missing */
+static int
+run_repeat_get(int id, int i) {
+    char command[64];
+    unsigned int row = (unsigned int) (id * 7919 + i * 104729) % REPEAT_ROWS;
+    int missing = row % 100 < (unsigned int) miss_percent;
+
+    snprintf(command, sizeof(command), "bench@%s%u@cf:q0", missing ? "missing" : "user", row);
+
+    char *value = get_value(command);
+    int ok = missing || value != NULL;
+
+    free(value);
+
+    return ok;
+}
+
+static int
+run_multi_get(int id, int i) {
+    char command[64 + MULTI_GET_ROWS * 24];
+    int len = snprintf(command, sizeof(command), "bench@");
+
+    for (int r = 0; r < MULTI_GET_ROWS; r++) {
+        len += snprintf(command + len, sizeof(command) - len, "%suser%d_%d_%d",
+                        r ? "," : "", id, i, r);
+    }
+
+    snprintf(command + len, sizeof(command) - len, "@cf:q0");
+
+    char *value = get_value(command);
+    int ok = value != NULL;
+
+    free(value);
+
+    return ok;
+}
+
+static int
+run_scan(int id, int i) {
+    char command[64];
+
+    snprintf(command, sizeof(command), "bench@row%08d~row%08d",
+             i * SCAN_ROWS, (i + 1) * SCAN_ROWS);
+
+    char *value = get_value(command);
+    int ok = value != NULL;
+
+    free(value);
+
+    return ok;
+}
+
+static int
+run_set(int id, int i) {
+    char command[64];
+
+    snprintf(command, sizeof(command), "bench@user%d_%d@cf:q0", id, i);
+
+    return set_value(command, "value", 5) == 0;
+}
+
+static void *
+caller_run(void *arg) {
+    caller_t *caller = (caller_t *) arg;
+
+    for (int i = 0; i < caller->operations; i++) {
+        uint64_t start = now_ns();
+
+        if (!caller->run(caller->id, i)) {
+            caller->failures++;
+        }
+
+        caller->latencies[i] = now_ns() - start;
+    }
+
+    return NULL;
+}
+
+/**
+ * Runs 'callers' threads doing 'total' operations between them, and prints
+ * the throughput, the latency percentiles and the allocator calls of one
+ * operation.
+ */
+static void
+scenario(const char *name, int (*run)(int id, int i), int callers, int total) {
+    caller_t caller[MAX_CALLERS];
+    int per_caller = total / callers > 0 ? total / callers : 1;
+    uint64_t *latencies = malloc(sizeof(uint64_t) * per_caller * callers);
+    int failures = 0;
+
+    for (int c = 0; c < callers; c++) {
+        caller[c].id = c;
+        caller[c].operations = per_caller;
+        caller[c].run = run;
+        caller[c].latencies = latencies + (size_t) c * per_caller;
+        caller[c].failures = 0;
+    }
+
+    alloc_count_t allocs_before;
+    alloc_count_t allocs_after;
+
+    alloc_count_get(&allocs_before);
+
+    uint64_t start = now_ns();
+
+    for (int c = 0; c < callers; c++) {
+        pthread_create(&caller[c].thread, NULL, caller_run, &caller[c]);
+    }
+
+    for (int c = 0; c < callers; c++) {
+        pthread_join(caller[c].thread, NULL);
+        failures += caller[c].failures;
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+    size_t count = (size_t) per_caller * callers;
+
+    alloc_count_get(&allocs_after);
+
+    qsort(latencies, count, sizeof(uint64_t), compare_u64);
+
+    printf("%-14s %3d caller%s %9.0f ops/s  p50 %8.1f  p90 %8.1f  p99 %8.1f  p999 %8.1f  max %8.1f us"
+           "  %6.1f allocs/op%s\n",
+           name, callers, callers > 1 ? "s" : " ", count / elapsed,
+           latencies[count / 2] / 1e3, latencies[count * 9 / 10] / 1e3,
+           latencies[count * 99 / 100] / 1e3, latencies[count * 999 / 1000] / 1e3,
+           latencies[count - 1] / 1e3,
+           (double) (allocs_after.allocations - allocs_before.allocations
+                     + allocs_after.reallocations - allocs_before.reallocations) / count,
+           failures ? "  FAILURES" : "");
+
+    free(latencies);
+}
+
+/* a streaming scan, drained through scan_value_async() */
+typedef struct stream_t_ {
+    pthread_mutex_t mutex;
+    pthread_cond_t cv;
+    size_t bytes;
+    int done;
+    int err;
+} stream_t;
+
+static void
+stream_callback(int err, char *chunk, int last, void *extra) {
+    stream_t *stream = (stream_t *) extra;
+
+    if (chunk) {
+        stream->bytes += strlen(chunk);
+        free(chunk);
+    }
+
+    if (last) {
+        pthread_mutex_lock(&stream->mutex);
+        stream->err = err;
+        stream->done = 1;
+        pthread_cond_signal(&stream->cv);
+        pthread_mutex_unlock(&stream->mutex);
+    }
+}
+
+static void
+streaming_scenario(size_t rows) {
+    stream_t stream;
+    char command[64];
+
+    memset(&stream, 0, sizeof(stream));
+    pthread_mutex_init(&stream.mutex, NULL);
+    pthread_cond_init(&stream.cv, NULL);
+    snprintf(command, sizeof(command), "bench@row~row%08zu", rows);
+
+    uint64_t start = now_ns();
+
+    if (scan_value_async(command, stream_callback, &stream) != 0) {
+        printf("stream scan     could not start\n");
+        return;
+    }
+
+    pthread_mutex_lock(&stream.mutex);
+    while (!stream.done) {
+        pthread_cond_wait(&stream.cv, &stream.mutex);
+    }
+    pthread_mutex_unlock(&stream.mutex);
+
+    double elapsed = (now_ns() - start) / 1e9;
+
+    printf("%-14s %zu rows in %.3f s: %9.0f rows/s %8.1f MB/s%s\n", "stream scan",
+           rows, elapsed, rows / elapsed, stream.bytes / elapsed / 1e6,
+           stream.err ? "  FAILED" : "");
+
+    pthread_cond_destroy(&stream.cv);
+    pthread_mutex_destroy(&stream.mutex);
+}
+
+static void
+usage(const char *program) {
+    fprintf(stderr, "usage: %s [-l latency_us] [-j jitter_us] [-t callback_threads] "
+            "[-c columns] [-v value_size] [-r locate_us] [-d stall_us] [-p stall_per_mille] "
+            "[-m miss_percent] [-n operations] [-s] "
+            "[setting=value ...]\n", program);
+    exit(2);
+}
+
+int
+main(int argc, char **argv) {
+    hedisConfigEntry entries[argc + 1];
+    hedisConfigEntry *entry_ptrs[argc + 1];
+    int entry_count = 0;
+    int print_stats = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:j:t:c:v:r:d:p:m:n:s")) != -1) {
+        switch (opt) {
+        case 'l': mock_hbase_config.latency_us = atol(optarg); break;
+        case 'j': mock_hbase_config.jitter_us = atol(optarg); break;
+        case 't': mock_hbase_config.threads = strtoul(optarg, NULL, 10); break;
+        case 'c': mock_hbase_config.columns = strtoul(optarg, NULL, 10); break;
+        case 'v': mock_hbase_config.value_size = strtoul(optarg, NULL, 10); break;
+        case 'r': mock_hbase_config.locate_us = atol(optarg); break;
+        case 'd': mock_hbase_config.stall_us = atol(optarg); break;
+        case 'p': mock_hbase_config.stall_per_mille = atol(optarg); break;
+        case 'm': miss_percent = atoi(optarg); break;
+        case 'n': operations = atoi(optarg); break;
+        case 's': print_stats = 1; break;
+        default:  usage(argv[0]);
+        }
+    }
+
+    entries[entry_count].key = "zookeeper";
+    entries[entry_count].value = "mock";
+    entry_ptrs[entry_count] = &entries[entry_count];
+    entry_count++;
+
+    for (int i = optind; i < argc; i++) {
+        char *separator = strchr(argv[i], '=');
+
+        if (separator == NULL) {
+            usage(argv[0]);
+        }
+
+        *separator = '\0';
+        entries[entry_count].key = argv[i];
+        entries[entry_count].value = separator + 1;
+        entry_ptrs[entry_count] = &entries[entry_count];
+        entry_count++;
+    }
+
+    // the connector logs every lookup; keep that off the terminal
+    setenv("HBASE_LOG_FILE", "/dev/null", 0);
+
+    uint64_t init_start = now_ns();
+
+    if (operations <= 0 || init(entry_ptrs, entry_count) != 0) {
+        fprintf(stderr, "could not initialize the connector\n");
+        return 1;
+    }
+
+    uint64_t init_end = now_ns();
+
+    printf("mock: %ld us latency (+%ld jitter), %zu callback threads, %zu columns x %zu B, "
+           "%ld us region lookups, %ld/1000 stalls of %ld us\n",
+           mock_hbase_config.latency_us, mock_hbase_config.jitter_us,
+           mock_hbase_config.threads, mock_hbase_config.columns, mock_hbase_config.value_size,
+           mock_hbase_config.locate_us, mock_hbase_config.stall_per_mille,
+           mock_hbase_config.stall_us);
+
+    // the very first lookup, before anything has warmed the connector up
+    run_get(MAX_CALLERS, 0);
+
+    printf("%-14s init %8.1f us  first get %8.1f us\n", "startup",
+           (init_end - init_start) / 1e3, (now_ns() - init_end) / 1e3);
+
+    scenario("get", run_get, 1, operations);
+    scenario("wide get", run_wide_get, 1, operations);
+    scenario("multi-get x10", run_multi_get, 1, operations / MULTI_GET_ROWS);
+    scenario("scan x1000", run_scan, 1, operations / 100 > 0 ? operations / 100 : 1);
+    streaming_scenario(mock_hbase_config.scan_rows);
+
+    for (int callers = 4; callers <= MAX_CALLERS; callers *= 4) {
+        scenario("get", run_get, callers, operations * callers / 4);
+    }
+
+    char repeat_name[32];
+
+    snprintf(repeat_name, sizeof(repeat_name), "get %d%% miss", miss_percent);
+    scenario(repeat_name, run_repeat_get, 16, operations * 4);
+
+    scenario("set", run_set, 16, operations * 4);
+
+    if (print_stats) {
+        char *stats = get_stats();
+
+        printf("%s\n", stats);
+        free(stats);
+    }
+
+    return 0;
+}
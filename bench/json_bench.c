@@ -0,0 +1,356 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../json.h"
+
+#line __LINE__ "json_bench.c"
+
+/*
+ * Fuzzes the row serializer and measures its throughput.
+ *
+ * The fuzzer serializes random rows mixing plain text, characters needing
+ * escapes, multi-byte UTF-8 and invalid bytes, then parses the output back
+ * and checks that every rowkey, name and value decodes to the input bytes.
+ * It also checks that serializing into a fixed buffer either produces the
+ * same output or reports ENOBUFS.
+ */
+
+#define FUZZ_ROUNDS 20000
+#define MAX_FIELD_LEN 64
+#define MAX_CELLS 8
+
+static double
+now_seconds() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+fail(const char *what, const char *json) {
+    fprintf(stderr, "FAILED: %s\n%s\n", what, json);
+    exit(1);
+}
+
+static size_t
+random_field(byte_t *out) {
+    static const char *pieces[] = {
+        "a", "Z", "09", "_", "\"", "\\", "\n", "\t", "\x01", "\x1f",
+        "\xc3\xa9", "\xe6\x97\xa5", "\xf0\x9f\x98\x80", "/", " "
+    };
+    size_t len = 0;
+    size_t count = rand() % 16;
+    int binary = rand() % 8 == 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (binary) {
+            out[len++] = rand() & 0xff;
+            continue;
+        }
+
+        const char *piece = pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+        size_t piece_len = strlen(piece);
+
+        if (len + piece_len > MAX_FIELD_LEN) {
+            break;
+        }
+
+        memcpy(out + len, piece, piece_len);
+        len += piece_len;
+    }
+
+    return len;
+}
+
+/* minimal parser of the serializer's output */
+typedef struct parser_t_ {
+    const char *p;
+    const char *json;
+} parser_t;
+
+static void
+expect(parser_t *parser, const char *literal) {
+    size_t len = strlen(literal);
+
+    if (strncmp(parser->p, literal, len) != 0) {
+        fail(literal, parser->json);
+    }
+
+    parser->p += len;
+}
+
+static int
+base64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+/* parses a string and returns its raw (still encoded) content */
+static size_t
+parse_string(parser_t *parser, byte_t *out) {
+    size_t len = 0;
+
+    expect(parser, "\"");
+
+    while (*parser->p != '"') {
+        unsigned char c = *parser->p++;
+
+        if (c == '\0' || c < 0x20) {
+            fail("unescaped control character", parser->json);
+        }
+
+        if (c != '\\') {
+            out[len++] = c;
+            continue;
+        }
+
+        c = *parser->p++;
+
+        switch (c) {
+        case '"':  out[len++] = '"';  break;
+        case '\\': out[len++] = '\\'; break;
+        case 'b':  out[len++] = '\b'; break;
+        case 'f':  out[len++] = '\f'; break;
+        case 'n':  out[len++] = '\n'; break;
+        case 'r':  out[len++] = '\r'; break;
+        case 't':  out[len++] = '\t'; break;
+        case 'u':
+            out[len++] = (byte_t) strtol((char[]) { parser->p[0], parser->p[1],
+                                                    parser->p[2], parser->p[3], 0 }, NULL, 16);
+            parser->p += 4;
+            break;
+        default:
+            fail("bad escape", parser->json);
+        }
+    }
+
+    parser->p++;
+
+    return len;
+}
+
+static size_t
+base64_decode(const byte_t *in, size_t len, byte_t *out) {
+    size_t out_len = 0;
+    uint32_t group = 0;
+    int bits = 0;
+
+    for (size_t i = 0; i < len && in[i] != '='; i++) {
+        int v = base64_value(in[i]);
+
+        if (v < 0) {
+            return (size_t) -1;
+        }
+
+        group = (group << 6) | v;
+        bits += 6;
+
+        if (bits >= 8) {
+            bits -= 8;
+            out[out_len++] = (group >> bits) & 0xff;
+        }
+    }
+
+    return out_len;
+}
+
+/* parses a string member plus its optional encoding member, decoded */
+static size_t
+parse_field(parser_t *parser, const char *encoding_member, byte_t *out) {
+    byte_t raw[(MAX_FIELD_LEN * 2 + 1) * 6];
+    size_t len = parse_string(parser, raw);
+
+    if (strncmp(parser->p, encoding_member, strlen(encoding_member)) == 0) {
+        expect(parser, encoding_member);
+        return base64_decode(raw, len, out);
+    }
+
+    memcpy(out, raw, len);
+
+    return len;
+}
+
+static void
+check_field(const char *what, const byte_t *want, size_t want_len,
+            const byte_t *got, size_t got_len, const char *json) {
+    if (want_len != got_len || memcmp(want, got, want_len) != 0) {
+        fail(what, json);
+    }
+}
+
+static void
+fuzz() {
+    byte_t key[MAX_FIELD_LEN];
+    byte_t families[MAX_CELLS][MAX_FIELD_LEN];
+    byte_t qualifiers[MAX_CELLS][MAX_FIELD_LEN];
+    byte_t values[MAX_CELLS][MAX_FIELD_LEN];
+    hb_cell_t cell_storage[MAX_CELLS];
+    const hb_cell_t *cells[MAX_CELLS];
+    byte_t decoded[MAX_FIELD_LEN * 3];
+    char fixed[512];
+
+    for (int round = 0; round < FUZZ_ROUNDS; round++) {
+        size_t key_len = random_field(key);
+        size_t cell_count = rand() % MAX_CELLS;
+
+        for (size_t i = 0; i < cell_count; i++) {
+            memset(&cell_storage[i], 0, sizeof(hb_cell_t));
+            cell_storage[i].family = families[i];
+            cell_storage[i].family_len = random_field(families[i]);
+            cell_storage[i].qualifier = qualifiers[i];
+            cell_storage[i].qualifier_len = random_field(qualifiers[i]);
+            cell_storage[i].value = values[i];
+            cell_storage[i].value_len = random_field(values[i]);
+            cells[i] = &cell_storage[i];
+        }
+
+        json_buf_t buf;
+
+        json_buf_init(&buf, 0);
+
+        if (json_write_row(&buf, key, key_len, cells, cell_count) != 0) {
+            fail("json_write_row", "");
+        }
+
+        parser_t parser = { buf.data, buf.data };
+        size_t len;
+
+        expect(&parser, "{\"rowkey\":");
+        len = parse_field(&parser, ",\"rowkey_encoding\":\"base64\"", decoded);
+        check_field("rowkey", key, key_len, decoded, len, buf.data);
+        expect(&parser, ",\"columns\":[");
+
+        for (size_t i = 0; i < cell_count; i++) {
+            byte_t name[MAX_FIELD_LEN * 2 + 1];
+            size_t name_len = cells[i]->family_len;
+
+            memcpy(name, cells[i]->family, cells[i]->family_len);
+            name[name_len++] = ':';
+            memcpy(name + name_len, cells[i]->qualifier, cells[i]->qualifier_len);
+            name_len += cells[i]->qualifier_len;
+
+            if (i != 0) {
+                expect(&parser, ",");
+            }
+
+            expect(&parser, "{\"name\":");
+            len = parse_field(&parser, ",\"name_encoding\":\"base64\"", decoded);
+            check_field("name", name, name_len, decoded, len, buf.data);
+            expect(&parser, ",\"value\":");
+            len = parse_field(&parser, ",\"encoding\":\"base64\"", decoded);
+            check_field("value", cells[i]->value, cells[i]->value_len, decoded, len, buf.data);
+            expect(&parser, "}");
+        }
+
+        expect(&parser, "]}");
+
+        if (*parser.p != '\0' || strlen(buf.data) != buf.len) {
+            fail("trailing data", buf.data);
+        }
+
+        json_buf_t fixed_buf;
+        size_t fixed_cap = 1 + rand() % sizeof(fixed);
+
+        json_buf_init_fixed(&fixed_buf, fixed, fixed_cap);
+
+        int err = json_write_row(&fixed_buf, key, key_len, cells, cell_count);
+
+        if (err == 0 && strcmp(fixed, buf.data) != 0) {
+            fail("fixed buffer output differs", fixed);
+        } else if (err != 0 && (err != ENOBUFS || buf.len + 1 <= fixed_cap)) {
+            fail("fixed buffer overflow", buf.data);
+        }
+
+        json_buf_free(&buf);
+    }
+
+    printf("fuzz: %d rows round-tripped\n", FUZZ_ROUNDS);
+}
+
+static void
+bench(const char *name, size_t rows, size_t cell_count, size_t value_len, int binary) {
+    byte_t *value = malloc(value_len);
+    hb_cell_t *cell_storage = calloc(cell_count, sizeof(hb_cell_t));
+    const hb_cell_t **cells = calloc(cell_count, sizeof(hb_cell_t *));
+    char qualifiers[cell_count][16];
+    const char key[] = "user0000000042";
+
+    for (size_t i = 0; i < value_len; i++) {
+        value[i] = binary ? (byte_t) rand() : (byte_t) ('a' + i % 26);
+    }
+
+    for (size_t i = 0; i < cell_count; i++) {
+        snprintf(qualifiers[i], sizeof(qualifiers[i]), "q%zu", i);
+        cell_storage[i].family = (byte_t *) "cf";
+        cell_storage[i].family_len = 2;
+        cell_storage[i].qualifier = (byte_t *) qualifiers[i];
+        cell_storage[i].qualifier_len = strlen(qualifiers[i]);
+        cell_storage[i].value = value;
+        cell_storage[i].value_len = value_len;
+        cells[i] = &cell_storage[i];
+    }
+
+    size_t bytes = 0;
+    double start = now_seconds();
+
+    for (size_t r = 0; r < rows; r++) {
+        json_buf_t buf;
+
+        json_buf_init(&buf, json_row_size_hint(sizeof(key) - 1, cells, cell_count));
+        json_write_row(&buf, (const byte_t *) key, sizeof(key) - 1, cells, cell_count);
+        bytes += buf.len;
+        json_buf_free(&buf);
+    }
+
+    double elapsed = now_seconds() - start;
+
+    printf("%-8s %6zu rows x %4zu cells x %5zu B: %9.0f rows/s %8.1f MB/s\n",
+           name, rows, cell_count, value_len,
+           rows / elapsed, bytes / elapsed / 1e6);
+
+    free(cells);
+    free(cell_storage);
+    free(value);
+}
+
+int
+main(int argc, char **argv) {
+    srand(argc > 1 ? atoi(argv[1]) : 42);
+
+    fuzz();
+
+    bench("tall", 1000000, 2, 16, 0);
+    bench("wide", 2000, 1000, 100, 0);
+    bench("large", 200, 4, 65536, 0);
+    bench("binary", 2000, 1000, 100, 1);
+
+    return 0;
+}
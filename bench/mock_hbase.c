@@ -0,0 +1,1011 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <hbase/hbase.h>
+
+#include "mock_hbase.h"
+
+#line __LINE__ "mock_hbase.c"
+
+#define MOCK_FAMILY "cf"
+#define MOCK_MISSING_PREFIX "missing"
+#define MOCK_SCAN_KEY_FORMAT "row%08zu"
+#define MOCK_SCAN_BOUND_LEN 64
+
+mock_hbase_config_t mock_hbase_config = {
+    .latency_us = 1000,
+    .jitter_us = 0,
+    .threads = 8,
+    .columns = 4,
+    .value_size = 32,
+    .scan_rows = 100000,
+    .locate_us = 0,
+    .stall_us = 0,
+    .stall_per_mille = 0,
+};
+
+static mock_hbase_stats_t mock_stats;
+
+/**
+ * Callback pool
+ *
+ * Jobs wait in a min-heap ordered by due time. Each pool thread sleeps until
+ * the earliest job is due, takes it and runs it unlocked.
+ */
+typedef struct mock_job_t_ {
+    uint64_t due;
+    void (*run)(void *arg);
+    void *arg;
+} mock_job_t;
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cv;
+static mock_job_t *jobs = NULL;
+static size_t job_count = 0;
+static size_t job_capacity = 0;
+
+static uint64_t
+now_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t
+latency_ns() {
+    static __thread unsigned int seed = 0;
+    long us = mock_hbase_config.latency_us;
+
+    if (seed == 0) {
+        seed = (unsigned int) (now_ns() ^ (uintptr_t) &seed);
+    }
+
+    if (mock_hbase_config.jitter_us > 0) {
+        seed = seed * 1103515245 + 12345;
+        us += (seed >> 8) % (mock_hbase_config.jitter_us + 1);
+    }
+
+    if (mock_hbase_config.stall_per_mille > 0) {
+        seed = seed * 1103515245 + 12345;
+
+        if ((seed >> 8) % 1000 < (unsigned int) mock_hbase_config.stall_per_mille) {
+            us += mock_hbase_config.stall_us;
+        }
+    }
+
+    return (uint64_t) us * 1000;
+}
+
+static void *
+pool_run(void *arg) {
+    pthread_mutex_lock(&pool_mutex);
+
+    for (;;) {
+        if (job_count == 0) {
+            pthread_cond_wait(&pool_cv, &pool_mutex);
+            continue;
+        }
+
+        uint64_t now = now_ns();
+
+        if (jobs[0].due > now) {
+            struct timespec deadline;
+
+            deadline.tv_sec = jobs[0].due / 1000000000;
+            deadline.tv_nsec = jobs[0].due % 1000000000;
+            pthread_cond_timedwait(&pool_cv, &pool_mutex, &deadline);
+            continue;
+        }
+
+        mock_job_t job = jobs[0];
+
+        // sift the last job down from the root
+        mock_job_t last = jobs[--job_count];
+        size_t i = 0;
+
+        for (;;) {
+            size_t child = 2 * i + 1;
+
+            if (child >= job_count) {
+                break;
+            }
+
+            if (child + 1 < job_count && jobs[child + 1].due < jobs[child].due) {
+                child++;
+            }
+
+            if (last.due <= jobs[child].due) {
+                break;
+            }
+
+            jobs[i] = jobs[child];
+            i = child;
+        }
+
+        jobs[i] = last;
+
+        // another job may be due already
+        if (job_count > 0) {
+            pthread_cond_signal(&pool_cv);
+        }
+
+        pthread_mutex_unlock(&pool_mutex);
+        job.run(job.arg);
+        pthread_mutex_lock(&pool_mutex);
+    }
+
+    return NULL;
+}
+
+static void
+start_pool() {
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pool_cv, &attr);
+    pthread_condattr_destroy(&attr);
+
+    size_t threads = mock_hbase_config.threads ? mock_hbase_config.threads : 1;
+
+    for (size_t i = 0; i < threads; i++) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, pool_run, NULL) == 0) {
+            pthread_detach(thread);
+        }
+    }
+}
+
+static void
+schedule_at(void (*run)(void *arg), void *arg, uint64_t due) {
+    mock_job_t job = { due, run, arg };
+
+    pthread_mutex_lock(&pool_mutex);
+
+    if (job_count == job_capacity) {
+        job_capacity = job_capacity ? job_capacity * 2 : 1024;
+        jobs = realloc(jobs, job_capacity * sizeof(mock_job_t));
+    }
+
+    size_t i = job_count++;
+
+    while (i > 0 && jobs[(i - 1) / 2].due > job.due) {
+        jobs[i] = jobs[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+
+    jobs[i] = job;
+
+    // a new earliest job shortens the sleep of every waiting thread
+    if (i == 0) {
+        pthread_cond_broadcast(&pool_cv);
+    } else {
+        pthread_cond_signal(&pool_cv);
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+static void
+schedule(void (*run)(void *arg), void *arg) {
+    schedule_at(run, arg, now_ns() + latency_ns());
+}
+
+/**
+ * Results
+ *
+ * A result and all of its cells live in one buffer, as they would after
+ * being copied out of the JVM. Like libhbase, the mock recycles result and
+ * get shells along with their buffers, unless a buffer grew beyond
+ * MOCK_MAX_RETAINED_BUFFER.
+ */
+#define MOCK_MAX_RETAINED_BUFFER (64 * 1024)
+
+typedef struct mock_result_t_ {
+    const char *table;
+    size_t table_len;
+    const byte_t *key;
+    size_t key_len;
+    size_t cell_count;
+    hb_cell_t *cells;
+    const hb_cell_t **cell_ptrs;
+    char *data;
+    size_t capacity;
+    struct mock_result_t_ *next_free;
+} mock_result_t;
+
+static pthread_mutex_t shell_mutex = PTHREAD_MUTEX_INITIALIZER;
+static mock_result_t *free_results = NULL;
+
+/**
+ * Grows '*buffer' to at least 'size' bytes. Its contents are lost.
+ */
+static int
+reserve(void **buffer, size_t *capacity, size_t size) {
+    if (size <= *capacity) {
+        return 0;
+    }
+
+    free(*buffer);
+    *buffer = malloc(size);
+    *capacity = *buffer ? size : 0;
+
+    return *buffer ? 0 : ENOMEM;
+}
+
+static hb_result_t
+new_result(const char *table, const byte_t *key, size_t key_len,
+           const byte_t *qualifier, size_t qualifier_len, size_t value_size) {
+    size_t table_len = strlen(table);
+    size_t cell_count = 0;
+
+    if (key_len < sizeof(MOCK_MISSING_PREFIX) - 1
+        || memcmp(key, MOCK_MISSING_PREFIX, sizeof(MOCK_MISSING_PREFIX) - 1) != 0) {
+        cell_count = qualifier ? 1 : mock_hbase_config.columns;
+    }
+
+    size_t size = table_len + 1 + key_len
+                  + cell_count * (sizeof(hb_cell_t) + sizeof(hb_cell_t *) + 24 + value_size)
+                  + qualifier_len + 16;
+
+    pthread_mutex_lock(&shell_mutex);
+    mock_result_t *result = free_results;
+
+    if (result != NULL) {
+        free_results = result->next_free;
+    }
+    pthread_mutex_unlock(&shell_mutex);
+
+    if (result == NULL) {
+        result = calloc(1, sizeof(mock_result_t));
+    }
+
+    reserve((void **) &result->data, &result->capacity, size);
+    char *p = result->data;
+
+    // cells first, so that they are aligned
+    result->cells = (hb_cell_t *) p;
+    p += cell_count * sizeof(hb_cell_t);
+    result->cell_ptrs = (const hb_cell_t **) p;
+    p += cell_count * sizeof(hb_cell_t *);
+
+    memcpy(p, table, table_len + 1);
+    result->table = p;
+    result->table_len = table_len;
+    p += table_len + 1;
+
+    memcpy(p, key, key_len);
+    result->key = cell_count ? (const byte_t *) p : NULL;
+    result->key_len = cell_count ? key_len : 0;
+    p += key_len;
+
+    result->cell_count = cell_count;
+
+    for (size_t i = 0; i < cell_count; i++) {
+        hb_cell_t *cell = &result->cells[i];
+
+        memset(cell, 0, sizeof(hb_cell_t));
+        cell->row = (byte_t *) result->key;
+        cell->row_len = key_len;
+        cell->family = (byte_t *) MOCK_FAMILY;
+        cell->family_len = sizeof(MOCK_FAMILY) - 1;
+
+        if (qualifier) {
+            memcpy(p, qualifier, qualifier_len);
+            cell->qualifier_len = qualifier_len;
+        } else {
+            cell->qualifier_len = sprintf(p, "q%zu", i);
+        }
+
+        cell->qualifier = (byte_t *) p;
+        p += cell->qualifier_len + 1;
+
+        for (size_t j = 0; j < value_size; j++) {
+            p[j] = 'a' + (i + j) % 26;
+        }
+
+        cell->value = (byte_t *) p;
+        cell->value_len = value_size;
+        cell->ts = 1;
+        p += value_size;
+
+        result->cell_ptrs[i] = cell;
+    }
+
+    return result;
+}
+
+int32_t
+hb_result_get_table(const hb_result_t result, const char **table, size_t *table_len) {
+    *table = ((mock_result_t *) result)->table;
+    *table_len = ((mock_result_t *) result)->table_len;
+    return 0;
+}
+
+int32_t
+hb_result_get_key(const hb_result_t result, const byte_t **key, size_t *key_len) {
+    *key = ((mock_result_t *) result)->key;
+    *key_len = ((mock_result_t *) result)->key_len;
+    return 0;
+}
+
+int32_t
+hb_result_get_cell_count(const hb_result_t result, size_t *count) {
+    *count = ((mock_result_t *) result)->cell_count;
+    return 0;
+}
+
+int32_t
+hb_result_get_cells(const hb_result_t result, const hb_cell_t ***cells, size_t *count) {
+    *cells = ((mock_result_t *) result)->cell_ptrs;
+    *count = ((mock_result_t *) result)->cell_count;
+    return 0;
+}
+
+int32_t
+hb_result_destroy(hb_result_t result_ptr) {
+    mock_result_t *result = (mock_result_t *) result_ptr;
+
+    if (result->capacity > MOCK_MAX_RETAINED_BUFFER) {
+        free(result->data);
+        result->data = NULL;
+        result->capacity = 0;
+    }
+
+    pthread_mutex_lock(&shell_mutex);
+    result->next_free = free_results;
+    free_results = result;
+    pthread_mutex_unlock(&shell_mutex);
+
+    return 0;
+}
+
+/**
+ * Connections, clients and admin
+ *
+ * Every client buffers its own mutations and caches the tables it has
+ * located, but all of them share the pool of callback threads.
+ */
+typedef struct mock_client_t_ {
+    pthread_mutex_t mutex;
+    struct mock_mutation_t_ *buffered_head;
+    struct mock_mutation_t_ *buffered_tail;
+    char **tables;
+    size_t table_count;
+} mock_client_t;
+
+/**
+ * @returns the extra latency of a request of 'client' to 'table', which is
+ * 'locate_us' for the first one and nothing afterwards
+ */
+static uint64_t
+locate_ns(hb_client_t client, const char *table) {
+    mock_client_t *mock = (mock_client_t *) client;
+    uint64_t ns = 0;
+
+    if (mock_hbase_config.locate_us <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&mock->mutex);
+
+    size_t i = 0;
+
+    while (i < mock->table_count && strcmp(mock->tables[i], table) != 0) {
+        i++;
+    }
+
+    if (i == mock->table_count) {
+        mock->tables = realloc(mock->tables, (i + 1) * sizeof(char *));
+        mock->tables[mock->table_count++] = strdup(table);
+        ns = (uint64_t) mock_hbase_config.locate_us * 1000;
+    }
+
+    pthread_mutex_unlock(&mock->mutex);
+
+    return ns;
+}
+
+int32_t
+hb_connection_create(const char *zk_quorum, const char *zk_root, hb_connection_t *connection) {
+    *connection = (hb_connection_t) &mock_hbase_config;
+    return 0;
+}
+
+int32_t
+hb_client_create(hb_connection_t connection, hb_client_t *client) {
+    mock_client_t *mock = calloc(1, sizeof(mock_client_t));
+
+    if (mock == NULL) {
+        return ENOMEM;
+    }
+
+    pthread_once(&pool_once, start_pool);
+    pthread_mutex_init(&mock->mutex, NULL);
+    *client = (hb_client_t) mock;
+    return 0;
+}
+
+typedef struct mock_prefetch_t_ {
+    hb_client_t client;
+    hb_client_prefetch_cb cb;
+    void *extra;
+} mock_prefetch_t;
+
+static void
+complete_prefetch(void *arg) {
+    mock_prefetch_t *prefetch = (mock_prefetch_t *) arg;
+
+    prefetch->cb(0, prefetch->client, prefetch->extra);
+    free(prefetch);
+}
+
+int32_t
+hb_client_prefetch_regions(hb_client_t client, const char *table,
+                           hb_client_prefetch_cb cb, void *extra) {
+    mock_prefetch_t *prefetch = malloc(sizeof(mock_prefetch_t));
+
+    if (prefetch == NULL) {
+        return ENOMEM;
+    }
+
+    prefetch->client = client;
+    prefetch->cb = cb;
+    prefetch->extra = extra;
+
+    schedule_at(complete_prefetch, prefetch, now_ns() + latency_ns() + locate_ns(client, table));
+
+    return 0;
+}
+
+int32_t
+hb_admin_create(hb_connection_t connection, hb_admin_t *admin) {
+    *admin = (hb_admin_t) &mock_hbase_config;
+    return 0;
+}
+
+int32_t
+hb_admin_table_exists(const hb_admin_t admin, const char *name_space, const char *table) {
+    return 0;
+}
+
+int32_t
+hb_admin_destroy(hb_admin_t admin, hb_admin_disconnection_cb cb, void *extra) {
+    if (cb) {
+        cb(0, admin, extra);
+    }
+    return 0;
+}
+
+/**
+ * Gets
+ */
+typedef struct mock_get_t_ {
+    char *table;                /* NUL-terminated, if table_len is not 0 */
+    size_t table_len;
+    size_t table_capacity;
+    byte_t *qualifier;
+    size_t qualifier_len;
+    size_t qualifier_capacity;
+    hb_client_t client;
+    hb_get_cb cb;
+    void *extra;
+    byte_t *key;
+    size_t key_len;
+    size_t key_capacity;
+    struct mock_get_t_ *next_free;
+} mock_get_t;
+
+static mock_get_t *free_gets = NULL;
+
+int32_t
+hb_get_create(const byte_t *rowkey, const size_t rowkey_len, hb_get_t *get_ptr) {
+    pthread_mutex_lock(&shell_mutex);
+    mock_get_t *get = free_gets;
+
+    if (get != NULL) {
+        free_gets = get->next_free;
+    }
+    pthread_mutex_unlock(&shell_mutex);
+
+    if (get == NULL) {
+        get = calloc(1, sizeof(mock_get_t));
+
+        if (get == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    if (reserve((void **) &get->key, &get->key_capacity, rowkey_len) != 0) {
+        hb_get_destroy(get);
+
+        return ENOMEM;
+    }
+
+    memcpy(get->key, rowkey, rowkey_len);
+    get->key_len = rowkey_len;
+    get->table_len = 0;
+    get->qualifier_len = 0;
+    *get_ptr = get;
+
+    return 0;
+}
+
+int32_t
+hb_get_add_column(hb_get_t get_ptr, const byte_t *family, const size_t family_len,
+                  const byte_t *qualifier, const size_t qualifier_len) {
+    mock_get_t *get = (mock_get_t *) get_ptr;
+
+    if (qualifier != NULL && qualifier_len > 0) {
+        if (reserve((void **) &get->qualifier, &get->qualifier_capacity, qualifier_len) != 0) {
+            return ENOMEM;
+        }
+
+        memcpy(get->qualifier, qualifier, qualifier_len);
+        get->qualifier_len = qualifier_len;
+    }
+
+    return 0;
+}
+
+int32_t
+hb_get_set_table(hb_get_t get_ptr, const char *table, const size_t table_len) {
+    mock_get_t *get = (mock_get_t *) get_ptr;
+
+    if (reserve((void **) &get->table, &get->table_capacity, table_len + 1) != 0) {
+        return ENOMEM;
+    }
+
+    memcpy(get->table, table, table_len);
+    get->table[table_len] = '\0';
+    get->table_len = table_len;
+
+    return 0;
+}
+
+int32_t
+hb_get_set_num_versions(hb_get_t get, const int32_t num_versions) {
+    return 0;
+}
+
+int32_t
+hb_get_destroy(hb_get_t get_ptr) {
+    mock_get_t *get = (mock_get_t *) get_ptr;
+
+    pthread_mutex_lock(&shell_mutex);
+    get->next_free = free_gets;
+    free_gets = get;
+    pthread_mutex_unlock(&shell_mutex);
+
+    return 0;
+}
+
+static void
+complete_get(void *arg) {
+    mock_get_t *get = (mock_get_t *) arg;
+    hb_result_t result = new_result(get->table, get->key, get->key_len,
+                                    get->qualifier_len ? get->qualifier : NULL,
+                                    get->qualifier_len,
+                                    mock_hbase_config.value_size);
+
+    __sync_add_and_fetch(&mock_stats.gets, 1);
+
+    get->cb(0, get->client, get, result, get->extra);
+}
+
+int32_t
+hb_get_send(hb_client_t client, hb_get_t get_ptr, hb_get_cb cb, void *extra) {
+    mock_get_t *get = (mock_get_t *) get_ptr;
+
+    if (get->table_len == 0 || cb == NULL) {
+        return EINVAL;
+    }
+
+    get->client = client;
+    get->cb = cb;
+    get->extra = extra;
+
+    schedule_at(complete_get, get, now_ns() + latency_ns() + locate_ns(client, get->table));
+
+    return 0;
+}
+
+/**
+ * Scanners
+ */
+typedef struct mock_scanner_t_ {
+    char *table;
+    char start[MOCK_SCAN_BOUND_LEN];
+    char end[MOCK_SCAN_BOUND_LEN];
+    byte_t *qualifier;
+    size_t qualifier_len;
+    size_t batch;
+    size_t next_row;
+    int started;
+    int busy;
+    hb_scanner_cb cb;
+    void *extra;
+} mock_scanner_t;
+
+int32_t
+hb_scanner_create(hb_client_t client, hb_scanner_t *scanner_ptr) {
+    mock_scanner_t *scanner = calloc(1, sizeof(mock_scanner_t));
+
+    if (scanner == NULL) {
+        return ENOMEM;
+    }
+
+    scanner->batch = 1;
+    *scanner_ptr = scanner;
+
+    return 0;
+}
+
+int32_t
+hb_scanner_set_table(hb_scanner_t scanner_ptr, const char *table, const size_t table_len) {
+    mock_scanner_t *scanner = (mock_scanner_t *) scanner_ptr;
+
+    free(scanner->table);
+    scanner->table = strndup(table, table_len);
+
+    return 0;
+}
+
+int32_t
+hb_scanner_set_start_row(hb_scanner_t scanner, const byte_t *start_row, const size_t start_row_len) {
+    snprintf(((mock_scanner_t *) scanner)->start, MOCK_SCAN_BOUND_LEN, "%.*s",
+             (int) start_row_len, start_row);
+    return 0;
+}
+
+int32_t
+hb_scanner_set_end_row(hb_scanner_t scanner, const byte_t *end_row, const size_t end_row_len) {
+    snprintf(((mock_scanner_t *) scanner)->end, MOCK_SCAN_BOUND_LEN, "%.*s",
+             (int) end_row_len, end_row);
+    return 0;
+}
+
+int32_t
+hb_scanner_set_column(hb_scanner_t scanner_ptr, const byte_t *family, const size_t family_len,
+                      const byte_t *qualifier, const size_t qualifier_len) {
+    mock_scanner_t *scanner = (mock_scanner_t *) scanner_ptr;
+
+    if (qualifier != NULL && qualifier_len > 0) {
+        free(scanner->qualifier);
+        scanner->qualifier = malloc(qualifier_len);
+        memcpy(scanner->qualifier, qualifier, qualifier_len);
+        scanner->qualifier_len = qualifier_len;
+    }
+
+    return 0;
+}
+
+int32_t
+hb_scanner_set_num_versions(hb_scanner_t scanner, const int8_t num_versions) {
+    return 0;
+}
+
+int32_t
+hb_scanner_set_num_max_rows(hb_scanner_t scanner, const size_t cache_size) {
+    ((mock_scanner_t *) scanner)->batch = cache_size ? cache_size : 1;
+    return 0;
+}
+
+/* index of the first synthetic row at or after 'key' */
+static size_t
+lower_bound(const char *key) {
+    size_t low = 0;
+    size_t high = mock_hbase_config.scan_rows;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        char row[32];
+
+        snprintf(row, sizeof(row), MOCK_SCAN_KEY_FORMAT, mid);
+
+        if (strcmp(row, key) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static void
+complete_scanner_next(void *arg) {
+    mock_scanner_t *scanner = (mock_scanner_t *) arg;
+
+    // libhbase allows one hb_scanner_next() at a time
+    if (__sync_fetch_and_add(&scanner->busy, 1) != 0) {
+        fprintf(stderr, "mock_hbase: concurrent hb_scanner_next() on one scanner\n");
+        abort();
+    }
+
+    if (!scanner->started) {
+        scanner->next_row = lower_bound(scanner->start);
+        scanner->started = 1;
+    }
+
+    hb_result_t *results = calloc(scanner->batch, sizeof(hb_result_t));
+    size_t count = 0;
+
+    while (count < scanner->batch && scanner->next_row < mock_hbase_config.scan_rows) {
+        char key[32];
+        int key_len = snprintf(key, sizeof(key), MOCK_SCAN_KEY_FORMAT, scanner->next_row);
+
+        if (scanner->end[0] != '\0' && strcmp(key, scanner->end) >= 0) {
+            scanner->next_row = mock_hbase_config.scan_rows;
+            break;
+        }
+
+        results[count++] = new_result(scanner->table, (const byte_t *) key, key_len,
+                                      scanner->qualifier, scanner->qualifier_len,
+                                      mock_hbase_config.value_size);
+        scanner->next_row++;
+    }
+
+    __sync_add_and_fetch(&mock_stats.scanner_batches, 1);
+    __sync_sub_and_fetch(&scanner->busy, 1);
+
+    scanner->cb(0, scanner, results, count, scanner->extra);
+
+    // as in libhbase, the callback owns the results but not the array
+    free(results);
+}
+
+int32_t
+hb_scanner_next(hb_scanner_t scanner_ptr, hb_scanner_cb cb, void *extra) {
+    mock_scanner_t *scanner = (mock_scanner_t *) scanner_ptr;
+
+    if (scanner->table == NULL || cb == NULL) {
+        return EINVAL;
+    }
+
+    scanner->cb = cb;
+    scanner->extra = extra;
+
+    schedule(complete_scanner_next, scanner);
+
+    return 0;
+}
+
+int32_t
+hb_scanner_destroy(hb_scanner_t scanner_ptr, hb_scanner_destroy_cb cb, void *extra) {
+    mock_scanner_t *scanner = (mock_scanner_t *) scanner_ptr;
+
+    if (cb) {
+        cb(0, scanner, extra);
+    }
+
+    free(scanner->table);
+    free(scanner->qualifier);
+    free(scanner);
+
+    return 0;
+}
+
+/**
+ * Mutations
+ *
+ * All increments add to a single counter, whatever their row and column.
+ */
+typedef struct mock_mutation_t_ {
+    int increment;
+    int bufferable;
+    int64_t amount;
+    hb_client_t client;
+    hb_mutation_cb cb;
+    void *extra;
+    struct mock_mutation_t_ *next;
+} mock_mutation_t;
+
+typedef struct mock_flush_t_ {
+    hb_client_t client;
+    hb_client_flush_cb cb;
+    void *extra;
+    mock_mutation_t *mutations;
+} mock_flush_t;
+
+static int64_t counter = 0;
+
+static int32_t
+new_mutation(int increment, hb_mutation_t *mutation_ptr) {
+    mock_mutation_t *mutation = calloc(1, sizeof(mock_mutation_t));
+
+    if (mutation == NULL) {
+        return ENOMEM;
+    }
+
+    mutation->increment = increment;
+    *mutation_ptr = mutation;
+
+    return 0;
+}
+
+int32_t
+hb_put_create(const byte_t *rowkey, const size_t rowkey_len, hb_put_t *put) {
+    return new_mutation(0, put);
+}
+
+int32_t
+hb_increment_create(const byte_t *rowkey, const size_t rowkey_len, hb_increment_t *increment) {
+    return new_mutation(1, increment);
+}
+
+int32_t
+hb_put_add_column(hb_put_t put, const byte_t *family, const size_t family_len,
+                  const byte_t *qualifier, const size_t qualifier_len,
+                  const byte_t *value, const size_t value_len) {
+    return family == NULL || value == NULL ? EINVAL : 0;
+}
+
+int32_t
+hb_increment_add_column(hb_increment_t increment, const hb_cell_t *cell, const int64_t amount) {
+    ((mock_mutation_t *) increment)->amount = amount;
+    return 0;
+}
+
+int32_t
+hb_mutation_set_table(hb_mutation_t mutation, const char *table, const size_t table_len) {
+    return 0;
+}
+
+int32_t
+hb_mutation_set_bufferable(hb_mutation_t mutation, const bool bufferable) {
+    ((mock_mutation_t *) mutation)->bufferable = bufferable;
+    return 0;
+}
+
+int32_t
+hb_mutation_set_direct_buffers(hb_mutation_t mutation, const bool direct) {
+    return 0;
+}
+
+int32_t
+hb_mutation_destroy(hb_mutation_t mutation) {
+    free(mutation);
+    return 0;
+}
+
+static void
+complete_mutation(mock_mutation_t *mutation) {
+    hb_result_t result = NULL;
+
+    if (mutation->increment) {
+        int64_t total = __sync_add_and_fetch(&counter, mutation->amount);
+        mock_result_t *r;
+
+        // the new value, as an 8-byte big-endian cell
+        result = new_result("", (const byte_t *) "counter", 7, (const byte_t *) "n", 1, 8);
+        r = (mock_result_t *) result;
+
+        for (int i = 0; i < 8; i++) {
+            r->cells[0].value[i] = (byte_t) ((uint64_t) total >> (56 - 8 * i));
+        }
+    }
+
+    __sync_add_and_fetch(&mock_stats.mutations, 1);
+
+    mutation->cb(0, mutation->client, mutation, result, mutation->extra);
+}
+
+static void
+complete_unbuffered_mutation(void *arg) {
+    complete_mutation((mock_mutation_t *) arg);
+}
+
+static void
+complete_flush(void *arg) {
+    mock_flush_t *flush = (mock_flush_t *) arg;
+    mock_mutation_t *mutation = flush->mutations;
+
+    while (mutation) {
+        mock_mutation_t *next = mutation->next;
+
+        complete_mutation(mutation);
+        mutation = next;
+    }
+
+    __sync_add_and_fetch(&mock_stats.flushes, 1);
+
+    flush->cb(0, flush->client, flush->extra);
+    free(flush);
+}
+
+int32_t
+hb_mutation_send(hb_client_t client, hb_mutation_t mutation_ptr, hb_mutation_cb cb, void *extra) {
+    mock_mutation_t *mutation = (mock_mutation_t *) mutation_ptr;
+
+    if (cb == NULL) {
+        return EINVAL;
+    }
+
+    mutation->client = client;
+    mutation->cb = cb;
+    mutation->extra = extra;
+
+    if (!mutation->bufferable) {
+        schedule(complete_unbuffered_mutation, mutation);
+        return 0;
+    }
+
+    mock_client_t *mock = (mock_client_t *) client;
+
+    mutation->next = NULL;
+
+    pthread_mutex_lock(&mock->mutex);
+
+    if (mock->buffered_tail) {
+        mock->buffered_tail->next = mutation;
+    } else {
+        mock->buffered_head = mutation;
+    }
+
+    mock->buffered_tail = mutation;
+
+    pthread_mutex_unlock(&mock->mutex);
+
+    return 0;
+}
+
+int32_t
+hb_client_flush(hb_client_t client, hb_client_flush_cb cb, void *extra) {
+    mock_flush_t *flush = malloc(sizeof(mock_flush_t));
+
+    if (flush == NULL) {
+        return ENOMEM;
+    }
+
+    flush->client = client;
+    flush->cb = cb;
+    flush->extra = extra;
+
+    mock_client_t *mock = (mock_client_t *) client;
+
+    pthread_mutex_lock(&mock->mutex);
+    flush->mutations = mock->buffered_head;
+    mock->buffered_head = NULL;
+    mock->buffered_tail = NULL;
+    pthread_mutex_unlock(&mock->mutex);
+
+    schedule(complete_flush, flush);
+
+    return 0;
+}
+
+void
+mock_hbase_get_stats(mock_hbase_stats_t *stats) {
+    stats->gets = __sync_add_and_fetch(&mock_stats.gets, 0);
+    stats->scanner_batches = __sync_add_and_fetch(&mock_stats.scanner_batches, 0);
+    stats->mutations = __sync_add_and_fetch(&mock_stats.mutations, 0);
+    stats->flushes = __sync_add_and_fetch(&mock_stats.flushes, 0);
+}
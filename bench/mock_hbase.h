@@ -0,0 +1,77 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_MOCK_HBASE_H_
+#define HEDIS_CONNECTOR_MOCK_HBASE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * In-process stand-in for the client side of libhbase: connections, clients,
+ * gets, results, scanners and mutations, with no JVM and no cluster.
+ *
+ * Requests complete on a pool of callback threads after a configurable
+ * latency, the way libhbase completes them on its JNI callback threads. Every
+ * rowkey exists, except those starting with "missing", and holds 'columns'
+ * cells of 'value_size' bytes in family "cf" named "q0", "q1", ... A get or
+ * scan naming a qualifier receives that cell only. Scanners walk the rowkeys
+ * "row00000000" up to 'scan_rows'. Bufferable mutations wait for
+ * hb_client_flush() of their client, which completes them all after one
+ * round trip. The first get of a client to a table, or its
+ * hb_client_prefetch_regions(), also pays 'locate_us' for the region lookup.
+ * 'stall_per_mille' requests out of 1000 take 'stall_us' longer, like those
+ * caught behind a garbage collection or a busy region server.
+ */
+typedef struct mock_hbase_config_t_ {
+    long latency_us;            /* round trip of a get, scanner batch or flush */
+    long jitter_us;             /* random extra latency, up to this much */
+    size_t threads;             /* callback threads */
+    size_t columns;             /* cells per row */
+    size_t value_size;          /* bytes per value */
+    size_t scan_rows;           /* rows a scanner walks */
+    long locate_us;             /* region lookup of a table new to a client */
+    long stall_us;              /* extra latency of a stalled request */
+    long stall_per_mille;       /* requests out of 1000 which stall */
+} mock_hbase_config_t;
+
+typedef struct mock_hbase_stats_t_ {
+    uint64_t gets;
+    uint64_t scanner_batches;
+    uint64_t mutations;
+    uint64_t flushes;
+} mock_hbase_stats_t;
+
+/**
+ * Read once, when the first client is created. Defaults to 1 ms of latency,
+ * 8 threads and 4 columns of 32 bytes over 100000 scannable rows, with no
+ * region lookups and no stalls.
+ */
+extern mock_hbase_config_t mock_hbase_config;
+
+void
+mock_hbase_get_stats(mock_hbase_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_MOCK_HBASE_H_ */
@@ -0,0 +1,159 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../stats.h"
+
+#line __LINE__ "stats_bench.c"
+
+/*
+ * Checks the percentiles of the latency histograms against exact ones and
+ * measures the cost of recording, from one thread and from several, next to
+ * a mutex guarded min/max/mean in the style of perftest's StatKeeper.
+ */
+
+#define SAMPLES 1000000
+#define THREADS 8
+
+static int
+compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void
+check() {
+    static uint64_t values[SAMPLES];
+    stats_snapshot_t *snapshot = malloc(sizeof(stats_snapshot_t));
+    const double percentiles[] = { 1, 50, 90, 99, 99.9, 100 };
+
+    // log-uniform from 1 ns to about 1 s, like a latency with a long tail
+    for (int i = 0; i < SAMPLES; i++) {
+        values[i] = (uint64_t) 1 << (rand() % 30);
+        values[i] += rand() % values[i];
+        stats_record(STATS_GET, values[i]);
+    }
+
+    qsort(values, SAMPLES, sizeof(uint64_t), compare_u64);
+    stats_snapshot(snapshot);
+
+    if (snapshot->stages[STATS_GET].count != SAMPLES) {
+        fprintf(stderr, "FAILED: recorded %llu samples\n",
+                (unsigned long long) snapshot->stages[STATS_GET].count);
+        exit(1);
+    }
+
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        size_t rank = (size_t) (percentiles[i] / 100 * SAMPLES + 0.5);
+        uint64_t exact = values[rank ? rank - 1 : 0];
+        uint64_t reported = stats_percentile(&snapshot->stages[STATS_GET], percentiles[i]);
+
+        if (reported < exact || reported > exact + exact / 16 + 1) {
+            fprintf(stderr, "FAILED: p%g is %llu, expected %llu\n", percentiles[i],
+                    (unsigned long long) reported, (unsigned long long) exact);
+            exit(1);
+        }
+
+        printf("check: p%-5g exact %10llu reported %10llu\n", percentiles[i],
+               (unsigned long long) exact, (unsigned long long) reported);
+    }
+
+    free(snapshot);
+}
+
+/* the StatKeeper way: one mutex around min, max and a running sum */
+static pthread_mutex_t keeper_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile uint64_t keeper_min = UINT64_MAX;
+static volatile uint64_t keeper_max = 0;
+static volatile uint64_t keeper_sum = 0;
+static volatile uint64_t keeper_count = 0;
+
+static void *
+record_keeper(void *arg) {
+    for (uint64_t i = 0; i < SAMPLES; i++) {
+        pthread_mutex_lock(&keeper_mutex);
+        keeper_min = i < keeper_min ? i : keeper_min;
+        keeper_max = i > keeper_max ? i : keeper_max;
+        keeper_sum += i;
+        keeper_count++;
+        pthread_mutex_unlock(&keeper_mutex);
+    }
+
+    return NULL;
+}
+
+static void *
+record_histogram(void *arg) {
+    for (uint64_t i = 0; i < SAMPLES; i++) {
+        stats_record(STATS_RPC, i * 97);
+    }
+
+    return NULL;
+}
+
+static void *
+record_timed(void *arg) {
+    for (uint64_t i = 0; i < SAMPLES; i++) {
+        stats_record_since(STATS_SEND, stats_now());
+    }
+
+    return NULL;
+}
+
+static void
+bench(const char *name, void *(*run)(void *), int threads) {
+    pthread_t workers[THREADS];
+    uint64_t start = stats_now();
+
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, run, NULL);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    double elapsed = (stats_now() - start) / 1e9;
+
+    printf("%-10s %d thread%s %12.0f records/s %8.1f ns/record/thread\n",
+           name, threads, threads > 1 ? "s" : " ",
+           threads * (double) SAMPLES / elapsed, elapsed * 1e9 / SAMPLES);
+}
+
+int
+main(int argc, char **argv) {
+    srand(argc > 1 ? atoi(argv[1]) : 42);
+
+    check();
+
+    bench("keeper", record_keeper, 1);
+    bench("keeper", record_keeper, THREADS);
+    bench("histogram", record_histogram, 1);
+    bench("histogram", record_histogram, THREADS);
+    bench("timed", record_timed, 1);
+    bench("timed", record_timed, THREADS);
+
+    return 0;
+}
@@ -0,0 +1,466 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache.h"
+
+#line __LINE__ "cache.c"
+
+#define MIN_BUCKETS_PER_SHARD 16
+#define DEFAULT_BUCKETS_PER_SHARD 1024
+#define VERSION_SLOTS 4096
+
+/**
+ * An entry is a single allocation holding the key followed by the
+ * NUL terminated value.
+ */
+typedef struct cache_entry_t_ {
+    uint64_t hash;
+    uint64_t expires_us;
+    size_t key_len;
+    size_t value_len;
+    struct cache_entry_t_ *chain_next;
+    struct cache_entry_t_ *lru_prev;
+    struct cache_entry_t_ *lru_next;
+    char data[];
+} cache_entry_t;
+
+/**
+ * Each shard has its own lock, hash table and LRU list, so lookups of
+ * unrelated rows only contend when they hash to the same shard.
+ */
+typedef struct cache_shard_t_ {
+    pthread_mutex_t mutex;
+    cache_entry_t **buckets;
+    size_t bucket_mask;
+    cache_entry_t *lru_head;
+    cache_entry_t *lru_tail;
+    size_t entries;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t expirations;
+} cache_shard_t;
+
+static cache_shard_t *shards = NULL;
+static size_t shard_mask = 0;
+static size_t shard_max_entries = 0;
+static size_t shard_max_bytes = 0;
+static uint64_t ttl_us = 0;
+
+/*
+ * Rows hash to version slots which an invalidation bumps, so that the answer
+ * of a get sent before a write is not cached after the write has dropped
+ * the row. A row's slot is bumped and checked under the lock of the row's
+ * shard, which orders the two for that row. Rows of other shards share the
+ * slot, so it is only ever accessed atomically.
+ */
+static uint32_t versions[VERSION_SLOTS];
+
+static uint64_t
+now_us() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static size_t
+round_up_pow2(size_t n) {
+    size_t p = 1;
+
+    while (p < n) {
+        p <<= 1;
+    }
+
+    return p;
+}
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+
+static uint64_t
+fnv(uint64_t hash, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/* FNV-1a over the table and rowkey part of the key */
+static uint64_t
+hash_row(const char *key, size_t row_len) {
+    return fnv(FNV_OFFSET_BASIS, key, row_len);
+}
+
+/* length of the "table\0rowkey\0" prefix of a key */
+static size_t
+row_prefix_len(const char *key, size_t key_len) {
+    const char *table_end = memchr(key, '\0', key_len);
+    const char *rowkey_end = memchr(table_end + 1, '\0', key_len - (table_end + 1 - key));
+
+    return rowkey_end + 1 - key;
+}
+
+static inline cache_shard_t *
+shard_of(uint64_t hash) {
+    return &shards[hash & shard_mask];
+}
+
+static inline uint32_t *
+version_of(uint64_t hash) {
+    return &versions[(hash >> 40) % VERSION_SLOTS];
+}
+
+static inline cache_entry_t **
+bucket_of(cache_shard_t *shard, uint64_t hash) {
+    return &shard->buckets[(hash >> 16) & shard->bucket_mask];
+}
+
+static inline size_t
+entry_size(const cache_entry_t *entry) {
+    return sizeof(cache_entry_t) + entry->key_len + entry->value_len + 1;
+}
+
+static void
+lru_unlink(cache_shard_t *shard, cache_entry_t *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+}
+
+static void
+lru_push_front(cache_shard_t *shard, cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+
+    if (shard->lru_head) {
+        shard->lru_head->lru_prev = entry;
+    } else {
+        shard->lru_tail = entry;
+    }
+
+    shard->lru_head = entry;
+}
+
+static void
+remove_entry(cache_shard_t *shard, cache_entry_t *entry) {
+    cache_entry_t **link = bucket_of(shard, entry->hash);
+
+    while (*link != entry) {
+        link = &(*link)->chain_next;
+    }
+
+    *link = entry->chain_next;
+
+    lru_unlink(shard, entry);
+
+    shard->entries--;
+    shard->bytes -= entry_size(entry);
+
+    free(entry);
+}
+
+static cache_entry_t *
+find_entry(cache_shard_t *shard, uint64_t hash, const char *key, size_t key_len) {
+    cache_entry_t *entry = *bucket_of(shard, hash);
+
+    while (entry) {
+        if (entry->hash == hash && entry->key_len == key_len
+            && memcmp(entry->data, key, key_len) == 0) {
+            return entry;
+        }
+
+        entry = entry->chain_next;
+    }
+
+    return NULL;
+}
+
+static void
+evict_over_bounds(cache_shard_t *shard) {
+    while (shard->lru_tail
+           && ((shard_max_entries && shard->entries > shard_max_entries)
+               || (shard_max_bytes && shard->bytes > shard_max_bytes))) {
+        remove_entry(shard, shard->lru_tail);
+        shard->evictions++;
+    }
+}
+
+int
+row_cache_init(size_t shard_count, size_t max_entries, size_t max_bytes, long ttl_ms) {
+    if (max_entries == 0 && max_bytes == 0) {
+        return 0;
+    }
+
+    if (shard_count == 0 || ttl_ms <= 0) {
+        return EINVAL;
+    }
+
+    shard_count = round_up_pow2(shard_count);
+
+    size_t buckets = DEFAULT_BUCKETS_PER_SHARD;
+
+    if (max_entries) {
+        buckets = round_up_pow2(max_entries / shard_count);
+
+        if (buckets < MIN_BUCKETS_PER_SHARD) {
+            buckets = MIN_BUCKETS_PER_SHARD;
+        }
+    }
+
+    cache_shard_t *new_shards = calloc(shard_count, sizeof(cache_shard_t));
+
+    if (new_shards == NULL) {
+        return ENOMEM;
+    }
+
+    for (size_t i = 0; i < shard_count; i++) {
+        pthread_mutex_init(&new_shards[i].mutex, NULL);
+        new_shards[i].buckets = calloc(buckets, sizeof(cache_entry_t *));
+        new_shards[i].bucket_mask = buckets - 1;
+
+        if (new_shards[i].buckets == NULL) {
+            for (size_t j = 0; j <= i; j++) {
+                free(new_shards[j].buckets);
+                pthread_mutex_destroy(&new_shards[j].mutex);
+            }
+
+            free(new_shards);
+
+            return ENOMEM;
+        }
+    }
+
+    // rounded up, as a share of 0 would lift the bound
+    shard_mask = shard_count - 1;
+    shard_max_entries = max_entries ? (max_entries + shard_count - 1) / shard_count : 0;
+    shard_max_bytes = max_bytes ? (max_bytes + shard_count - 1) / shard_count : 0;
+    ttl_us = (uint64_t) ttl_ms * 1000;
+    shards = new_shards;
+
+    return 0;
+}
+
+int
+row_cache_enabled() {
+    return shards != NULL;
+}
+
+char *
+row_cache_key(const char *table, const char *rowkey, size_t rowkey_len,
+              const char *family, const char *qualifier, size_t *key_len) {
+    size_t table_len = strlen(table);
+    size_t family_len = family ? strlen(family) : 0;
+    size_t qualifier_len = qualifier ? strlen(qualifier) : 0;
+
+    *key_len = table_len + 1 + rowkey_len + 1 + family_len + 1 + qualifier_len;
+
+    char *key = malloc(*key_len);
+    char *p = key;
+
+    if (key == NULL) {
+        return NULL;
+    }
+
+    memcpy(p, table, table_len);
+    p += table_len;
+    *p++ = '\0';
+    memcpy(p, rowkey, rowkey_len);
+    p += rowkey_len;
+    *p++ = '\0';
+    if (family_len) {
+        memcpy(p, family, family_len);
+        p += family_len;
+    }
+    *p++ = '\0';
+    if (qualifier_len) {
+        memcpy(p, qualifier, qualifier_len);
+    }
+
+    return key;
+}
+
+char *
+row_cache_get(const char *key, size_t key_len) {
+    uint64_t hash = hash_row(key, row_prefix_len(key, key_len));
+    cache_shard_t *shard = shard_of(hash);
+    char *value = NULL;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    cache_entry_t *entry = find_entry(shard, hash, key, key_len);
+
+    if (entry && entry->expires_us <= now_us()) {
+        remove_entry(shard, entry);
+        shard->expirations++;
+        entry = NULL;
+    }
+
+    if (entry) {
+        lru_unlink(shard, entry);
+        lru_push_front(shard, entry);
+
+        value = malloc(entry->value_len + 1);
+
+        if (value != NULL) {
+            memcpy(value, entry->data + entry->key_len, entry->value_len + 1);
+        }
+
+        shard->hits++;
+    } else {
+        shard->misses++;
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return value;
+}
+
+uint32_t
+row_cache_version(const char *key, size_t key_len) {
+    uint64_t hash = hash_row(key, row_prefix_len(key, key_len));
+
+    return __atomic_load_n(version_of(hash), __ATOMIC_ACQUIRE);
+}
+
+void
+row_cache_put(const char *key, size_t key_len, const char *value, uint32_t version) {
+    uint64_t hash = hash_row(key, row_prefix_len(key, key_len));
+    cache_shard_t *shard = shard_of(hash);
+    size_t value_len = strlen(value);
+
+    cache_entry_t *entry = malloc(sizeof(cache_entry_t) + key_len + value_len + 1);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->hash = hash;
+    entry->expires_us = now_us() + ttl_us;
+    entry->key_len = key_len;
+    entry->value_len = value_len;
+    memcpy(entry->data, key, key_len);
+    memcpy(entry->data + key_len, value, value_len + 1);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    // the row was written after the get was sent, so this may be stale
+    if (__atomic_load_n(version_of(hash), __ATOMIC_ACQUIRE) != version) {
+        pthread_mutex_unlock(&shard->mutex);
+        free(entry);
+
+        return;
+    }
+
+    cache_entry_t *old = find_entry(shard, hash, key, key_len);
+
+    if (old) {
+        remove_entry(shard, old);
+    }
+
+    cache_entry_t **bucket = bucket_of(shard, hash);
+    entry->chain_next = *bucket;
+    *bucket = entry;
+
+    lru_push_front(shard, entry);
+
+    shard->entries++;
+    shard->bytes += entry_size(entry);
+
+    evict_over_bounds(shard);
+
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void
+row_cache_invalidate_row(const char *table, const char *rowkey, size_t rowkey_len) {
+    if (shards == NULL) {
+        return;
+    }
+
+    // the "table\0rowkey\0" prefix of the keys of the row, hashed in place
+    size_t table_len = strlen(table);
+    size_t prefix_len = table_len + 1 + rowkey_len + 1;
+    uint64_t hash = fnv(FNV_OFFSET_BASIS, table, table_len + 1);
+
+    hash = fnv(hash, rowkey, rowkey_len);
+    hash = fnv(hash, "", 1);
+
+    cache_shard_t *shard = shard_of(hash);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    __atomic_add_fetch(version_of(hash), 1, __ATOMIC_RELEASE);
+
+    cache_entry_t *entry = *bucket_of(shard, hash);
+
+    while (entry) {
+        cache_entry_t *next = entry->chain_next;
+
+        if (entry->hash == hash && entry->key_len >= prefix_len
+            && memcmp(entry->data, table, table_len + 1) == 0
+            && memcmp(entry->data + table_len + 1, rowkey, rowkey_len) == 0
+            && entry->data[prefix_len - 1] == '\0') {
+            remove_entry(shard, entry);
+        }
+
+        entry = next;
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void
+row_cache_get_stats(row_cache_stats_t *stats) {
+    memset(stats, 0, sizeof(row_cache_stats_t));
+
+    if (shards == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i <= shard_mask; i++) {
+        cache_shard_t *shard = &shards[i];
+
+        pthread_mutex_lock(&shard->mutex);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->expirations += shard->expirations;
+        stats->entries += shard->entries;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
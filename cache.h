@@ -0,0 +1,103 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_CACHE_H_
+#define HEDIS_CONNECTOR_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * In-process cache of rendered JSON values, keyed by table, rowkey, family
+ * and qualifier. Entries expire after a TTL and each shard evicts in LRU
+ * order once it goes over its share of the entry and byte bounds.
+ */
+typedef struct row_cache_stats_t_ {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t expirations;
+    uint64_t entries;
+    uint64_t bytes;
+} row_cache_stats_t;
+
+/**
+ * Sets up the cache. A zero bound means unbounded on that axis, but at least
+ * one of 'max_entries' and 'max_bytes' must be set for the cache to be
+ * enabled. 'shards' is rounded up to a power of two, and each shard gets
+ * its share of the bounds, rounded up.
+ *
+ * @returns 0 on success, an errno value otherwise.
+ */
+int
+row_cache_init(size_t shards, size_t max_entries, size_t max_bytes, long ttl_ms);
+
+/**
+ * @returns non-zero once row_cache_init() has enabled the cache.
+ */
+int
+row_cache_enabled();
+
+/**
+ * Builds the cache key of a lookup into a newly allocated buffer, or returns
+ * NULL if it cannot be allocated. 'family' and 'qualifier' may be NULL.
+ */
+char *
+row_cache_key(const char *table, const char *rowkey, size_t rowkey_len,
+              const char *family, const char *qualifier, size_t *key_len);
+
+/**
+ * @returns a newly allocated copy of the cached value, or NULL on a miss or
+ * if the copy cannot be allocated.
+ */
+char *
+row_cache_get(const char *key, size_t key_len);
+
+/**
+ * @returns the version of the row of 'key', which row_cache_invalidate_row()
+ * changes. Take it before sending the get whose answer goes to
+ * row_cache_put().
+ */
+uint32_t
+row_cache_version(const char *key, size_t key_len);
+
+/**
+ * Caches a copy of 'value' under 'key', replacing any previous entry, unless
+ * the row has been invalidated since row_cache_version() returned 'version'.
+ */
+void
+row_cache_put(const char *key, size_t key_len, const char *value, uint32_t version);
+
+/**
+ * Drops every cached column variant of a row, and keeps answers to gets
+ * sent before this from being cached.
+ */
+void
+row_cache_invalidate_row(const char *table, const char *rowkey, size_t rowkey_len);
+
+void
+row_cache_get_stats(row_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_CACHE_H_ */
@@ -0,0 +1,281 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "command.h"
+
+#line __LINE__ "command.c"
+
+/* must be a power of two */
+#define COMMAND_PLAN_SLOTS 256
+
+/* character classes of the command grammar */
+#define CLASS_TABLE     0x01
+#define CLASS_ROWKEY    0x02
+#define CLASS_FAMILY    0x04
+#define CLASS_QUALIFIER 0x08
+
+/*
+ * Plans are published once into a slot and never freed, so a reader holding
+ * one needs no reference count. A command whose slot is taken by another
+ * plan gets a private plan instead.
+ */
+static command_plan_t *plans[COMMAND_PLAN_SLOTS];
+
+static inline int
+char_class(unsigned char c) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+        || (c >= '0' && c <= '9') || c == '_' || c == '-') {
+        return CLASS_TABLE | CLASS_ROWKEY | CLASS_FAMILY | CLASS_QUALIFIER;
+    }
+
+    switch (c) {
+    case '#':  return CLASS_ROWKEY | CLASS_FAMILY;
+    case '\\': return CLASS_ROWKEY | CLASS_FAMILY;
+    case ':':  return CLASS_ROWKEY;
+    case ',':  return CLASS_ROWKEY;
+    case '@':  return CLASS_FAMILY;
+    default:   return 0;
+    }
+}
+
+static inline const char *
+scan_class(const char *p, int class) {
+    while (char_class(*p) & class) {
+        p++;
+    }
+
+    return p;
+}
+
+int
+hedis_command_parse(const char *str, hedis_command_t *command) {
+    const char *p = str;
+    const char *end;
+
+    memset(command, 0, sizeof(hedis_command_t));
+
+    end = scan_class(p, CLASS_TABLE);
+
+    if (end == p || *end != '@') {
+        return EINVAL;
+    }
+
+    command->table = p;
+    command->table_len = end - p;
+    p = end + 1;
+
+    end = scan_class(p, CLASS_ROWKEY);
+
+    command->rowkey = p;
+    command->rowkey_len = end - p;
+    p = end;
+
+    if (*p == '~') {
+        command->scan = HEDIS_SCAN_RANGE;
+        command->end_row = p + 1;
+        p = scan_class(p + 1, CLASS_ROWKEY);
+        command->end_row_len = p - command->end_row;
+    } else if (*p == '*') {
+        command->scan = HEDIS_SCAN_PREFIX;
+        p++;
+    } else if (command->rowkey_len == 0) {
+        return EINVAL;
+    }
+
+    // a scan takes a single range, not a list of rowkeys
+    if (command->scan != HEDIS_SCAN_NONE
+        && (memchr(command->rowkey, ',', command->rowkey_len) != NULL
+            || (command->end_row != NULL
+                && memchr(command->end_row, ',', command->end_row_len) != NULL))) {
+        return EINVAL;
+    }
+
+    if (*p != '@') {
+        return 0;
+    }
+
+    end = scan_class(p + 1, CLASS_FAMILY);
+
+    if (end == p + 1) {
+        return 0;
+    }
+
+    command->family = p + 1;
+    command->family_len = end - (p + 1);
+    p = end;
+
+    if (*p != ':') {
+        return 0;
+    }
+
+    end = scan_class(p + 1, CLASS_QUALIFIER);
+
+    if (end != p + 1) {
+        command->qualifier = p + 1;
+        command->qualifier_len = end - (p + 1);
+    }
+
+    return 0;
+}
+
+/*
+ * FNV-1a, with the field lengths mixed in so "a"+"bc" differs from "ab"+"c"
+ * and an absent field differs from an empty one.
+ */
+static uint64_t
+hash_field(uint64_t hash, const char *field, size_t len) {
+    if (field == NULL) {
+        len = (size_t) -1;
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            hash ^= (unsigned char) field[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    hash ^= len;
+    hash *= 1099511628211ULL;
+
+    return hash;
+}
+
+static uint64_t
+hash_command(const hedis_command_t *command) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    hash = hash_field(hash, command->table, command->table_len);
+    hash = hash_field(hash, command->family, command->family_len);
+    hash = hash_field(hash, command->qualifier, command->qualifier_len);
+
+    return hash;
+}
+
+static inline int
+same_field(const char *a, size_t a_len, const char *b, size_t b_len) {
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+
+    return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+static int
+plan_matches(const command_plan_t *plan, uint64_t hash, const hedis_command_t *command) {
+    return plan->hash == hash
+        && same_field(plan->table, plan->table_len, command->table, command->table_len)
+        && same_field(plan->family, plan->family_len, command->family, command->family_len)
+        && same_field(plan->qualifier, plan->qualifier_len, command->qualifier, command->qualifier_len);
+}
+
+static const char *
+copy_field(char **p, const char *field, size_t len) {
+    if (field == NULL) {
+        return NULL;
+    }
+
+    char *copy = *p;
+
+    memcpy(copy, field, len);
+    copy[len] = '\0';
+    *p += len + 1;
+
+    return copy;
+}
+
+static command_plan_t *
+new_plan(uint64_t hash, const hedis_command_t *command) {
+    size_t data_len = command->table_len + 1
+                      + (command->family ? command->family_len + 1 : 0)
+                      + (command->qualifier ? command->qualifier_len + 1 : 0);
+    command_plan_t *plan = malloc(sizeof(command_plan_t) + data_len);
+
+    if (plan == NULL) {
+        return NULL;
+    }
+
+    char *p = plan->data;
+
+    plan->hash = hash;
+    plan->cached = 0;
+    plan->table = copy_field(&p, command->table, command->table_len);
+    plan->table_len = command->table_len;
+    plan->family = copy_field(&p, command->family, command->family_len);
+    plan->family_len = command->family_len;
+    plan->qualifier = copy_field(&p, command->qualifier, command->qualifier_len);
+    plan->qualifier_len = command->qualifier_len;
+
+    return plan;
+}
+
+const command_plan_t *
+command_plan_acquire(const hedis_command_t *command) {
+    uint64_t hash = hash_command(command);
+    command_plan_t **slot = &plans[hash & (COMMAND_PLAN_SLOTS - 1)];
+    command_plan_t *plan = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+    if (plan != NULL && plan_matches(plan, hash, command)) {
+        return plan;
+    }
+
+    command_plan_t *fresh = new_plan(hash, command);
+
+    if (fresh == NULL || plan != NULL) {
+        return fresh;
+    }
+
+    fresh->cached = 1;
+
+    if (__sync_bool_compare_and_swap(slot, NULL, fresh)) {
+        return fresh;
+    }
+
+    // another thread filled the slot first
+    fresh->cached = 0;
+
+    return fresh;
+}
+
+const command_plan_t *
+command_plan_retain(const command_plan_t *plan) {
+    if (plan->cached) {
+        // cached plans are never freed
+        return plan;
+    }
+
+    hedis_command_t command;
+
+    memset(&command, 0, sizeof(command));
+    command.table = plan->table;
+    command.table_len = plan->table_len;
+    command.family = plan->family;
+    command.family_len = plan->family_len;
+    command.qualifier = plan->qualifier;
+    command.qualifier_len = plan->qualifier_len;
+
+    return new_plan(plan->hash, &command);
+}
+
+void
+command_plan_release(const command_plan_t *plan) {
+    if (plan != NULL && !plan->cached) {
+        free((void *) plan);
+    }
+}
@@ -0,0 +1,104 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_COMMAND_H_
+#define HEDIS_CONNECTOR_COMMAND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+#define HEDIS_SCAN_NONE   0
+#define HEDIS_SCAN_RANGE  1 /* table@start~end */
+#define HEDIS_SCAN_PREFIX 2 /* table@prefix* */
+
+/**
+ * A parsed "table@rowkey[@family[:qualifier]]" command. Every field points
+ * into the command string and is not NUL terminated; 'family' and
+ * 'qualifier' are NULL when absent.
+ *
+ * For a scan, 'rowkey' is the start row or the prefix and 'end_row' the end
+ * of a range; either may be empty to leave that side of the range open.
+ */
+typedef struct hedis_command_t_ {
+    const char *table;
+    size_t table_len;
+    int scan;
+    const char *rowkey;
+    size_t rowkey_len;
+    const char *end_row;
+    size_t end_row_len;
+    const char *family;
+    size_t family_len;
+    const char *qualifier;
+    size_t qualifier_len;
+} hedis_command_t;
+
+/**
+ * The part of a command shared by every lookup of the same table and column
+ * spec, with NUL terminated copies of the names.
+ */
+typedef struct command_plan_t_ {
+    uint64_t hash;
+    int cached;
+    const char *table;
+    size_t table_len;
+    const char *family;
+    size_t family_len;
+    const char *qualifier;
+    size_t qualifier_len;
+    char data[];
+} command_plan_t;
+
+/**
+ * Tokenizes a command without allocating. Parsing stops at the first
+ * character the grammar does not allow, so trailing input is ignored.
+ *
+ * @returns 0 on success, EINVAL if the command has no table or rowkey, or if
+ * a scan lists several rowkeys.
+ */
+int
+hedis_command_parse(const char *str, hedis_command_t *command);
+
+/**
+ * @returns the plan of a command, from the plan cache when the same table and
+ * column spec were seen before, or NULL if out of memory. The plan must be
+ * handed back with command_plan_release().
+ */
+const command_plan_t *
+command_plan_acquire(const hedis_command_t *command);
+
+/**
+ * @returns a reference to 'plan' which stays valid after the command it was
+ * acquired for has released it, or NULL if out of memory. Cached plans are
+ * shared, others are copied. The reference is handed back with
+ * command_plan_release().
+ */
+const command_plan_t *
+command_plan_retain(const command_plan_t *plan);
+
+void
+command_plan_release(const command_plan_t *plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_COMMAND_H_ */
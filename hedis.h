@@ -1,4 +1,106 @@
+#include <stddef.h>
+
 typedef struct {
 	char *key;
 	char *value;
-} hedisConfigEntry;
\ No newline at end of file
+} hedisConfigEntry;
+
+/**
+ * Completion callback of get_value_async(). 'err' is 0 on success, in which
+ * case 'value' holds the row as JSON (or NULL if the row does not exist) and
+ * is owned by the callback. It is invoked on a libhbase callback thread, or
+ * on the timer thread for a lookup which reached its deadline, and must not
+ * block.
+ */
+typedef void (*hedis_value_cb)(int err, char *value, void *extra);
+
+/**
+ * Looks up a Hedis command and blocks until the value arrives, or until the
+ * "request_timeout_ms" setting has passed.
+ */
+char *get_value(const char *str);
+
+/**
+ * Like get_value(), with a deadline of 'timeout_ms' milliseconds instead of
+ * the "request_timeout_ms" setting, or none if it is 0. Returns NULL if the
+ * lookup has not completed by then.
+ */
+char *get_value_timeout(const char *str, long timeout_ms);
+
+/**
+ * Starts looking up a Hedis command and returns without waiting for HBase.
+ *
+ * Returns 0 once the request has been sent, in which case 'cb' is invoked
+ * exactly once. A non-zero error code means the request was rejected and
+ * 'cb' will not be called.
+ *
+ * A scan command hands over the whole range as one JSON array. If the
+ * "scan_max_rows" setting is non-zero and the range holds more rows, the
+ * scan completes with EOVERFLOW and no value instead of being cut short.
+ */
+int get_value_async(const char *str, hedis_value_cb cb, void *extra);
+
+/**
+ * Like get_value_async(), with a deadline of 'timeout_ms' milliseconds
+ * instead of the "request_timeout_ms" setting, or none if it is 0. A row
+ * whose get has not answered by then completes with ETIMEDOUT, and its
+ * answer is dropped when it arrives. Scans are not cut short.
+ */
+int get_value_async_timeout(const char *str, long timeout_ms, hedis_value_cb cb, void *extra);
+
+/**
+ * Chunk callback of scan_value_async(). Each chunk is a JSON array of rows,
+ * owned by the callback, and chunks arrive in row order. The stream ends with
+ * one call where 'last' is non-zero and 'chunk' is NULL; 'err' is then 0 if
+ * the whole range was read. It is invoked on a libhbase callback thread and
+ * must not block.
+ */
+typedef void (*hedis_scan_cb)(int err, char *chunk, int last, void *extra);
+
+/**
+ * Starts streaming a scan command ("table@start~end" or "table@prefix*").
+ *
+ * Returns 0 once the scan has started, in which case 'cb' is invoked until
+ * its last call. A non-zero error code means the scan was rejected and 'cb'
+ * will not be called.
+ */
+int scan_value_async(const char *str, hedis_scan_cb cb, void *extra);
+
+/**
+ * Starts writing 'value' to the column named by "table@rowkey@family:qualifier".
+ *
+ * The write is buffered and committed together with others (see the
+ * write_batch_* settings). 'cb' is invoked once the batch has been flushed,
+ * with a NULL value. A non-zero error code means the write was rejected and
+ * 'cb' will not be called.
+ */
+int set_value_async(const char *str, const char *value, size_t value_len,
+                    hedis_value_cb cb, void *extra);
+
+/**
+ * Starts adding 'amount' to the 64-bit counter in the column named by
+ * "table@rowkey@family:qualifier". Batched like set_value_async(); 'cb'
+ * receives the new value as a decimal string.
+ */
+int incr_value_async(const char *str, long long amount, hedis_value_cb cb, void *extra);
+
+/**
+ * Writes a value and blocks until it is durable. Returns 0 on success, or
+ * ETIMEDOUT once "request_timeout_ms" has passed, in which case the write
+ * may still be committed later.
+ */
+int set_value(const char *str, const char *value, size_t value_len);
+
+/**
+ * Increments a counter and blocks until it is durable. Returns the new value
+ * as a decimal string, or NULL on failure.
+ */
+char *incr_value(const char *str, long long amount);
+
+/**
+ * Returns the connector statistics as a newly allocated JSON object: latency
+ * percentiles of each stage of the lookup, scan and write paths, counters,
+ * errors by code and row cache statistics. The same object is returned for
+ * the "@stats" command.
+ */
+char *get_stats();
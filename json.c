@@ -0,0 +1,394 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+#line __LINE__ "json.c"
+
+#define JSON_MIN_CAPACITY 256
+#define JSON_ROW_OVERHEAD 32
+#define JSON_CELL_OVERHEAD 32
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static const char base64_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* bytes which can be copied into a JSON string as they are */
+static int
+is_plain(byte_t c) {
+    return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+}
+
+/* makes room for 'extra' more bytes and the terminating NUL */
+static int
+reserve(json_buf_t *buf, size_t extra) {
+    size_t needed = buf->len + extra + 1;
+
+    if (buf->overflow) {
+        return -1;
+    }
+
+    if (needed <= buf->cap) {
+        return 0;
+    }
+
+    if (!buf->owned) {
+        buf->overflow = 1;
+        return -1;
+    }
+
+    size_t cap = buf->cap ? buf->cap : JSON_MIN_CAPACITY;
+
+    while (cap < needed) {
+        cap <<= 1;
+    }
+
+    char *data = realloc(buf->data, cap);
+
+    if (data == NULL) {
+        buf->overflow = 1;
+        return -1;
+    }
+
+    buf->data = data;
+    buf->cap = cap;
+
+    return 0;
+}
+
+static inline void
+put_bytes(json_buf_t *buf, const void *src, size_t len) {
+    if (len > 0 && reserve(buf, len) == 0) {
+        memcpy(buf->data + buf->len, src, len);
+        buf->len += len;
+        buf->data[buf->len] = '\0';
+    }
+}
+
+#define put_literal(buf, literal) put_bytes(buf, literal, sizeof(literal) - 1)
+
+/* length of the UTF-8 sequence starting at 'str', 0 if it is invalid */
+static size_t
+utf8_sequence_len(const byte_t *str, size_t len) {
+    byte_t c = str[0];
+    size_t n;
+    uint32_t code_point;
+
+    if (c >= 0xc2 && c <= 0xdf) {
+        n = 2;
+        code_point = c & 0x1f;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        n = 3;
+        code_point = c & 0x0f;
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        n = 4;
+        code_point = c & 0x07;
+    } else {
+        return 0;
+    }
+
+    if (n > len) {
+        return 0;
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        if ((str[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+
+        code_point = (code_point << 6) | (str[i] & 0x3f);
+    }
+
+    /* overlong forms, surrogates and code points past U+10FFFF */
+    if ((n == 3 && code_point < 0x800)
+        || (n == 4 && (code_point < 0x10000 || code_point > 0x10ffff))
+        || (code_point >= 0xd800 && code_point <= 0xdfff)) {
+        return 0;
+    }
+
+    return n;
+}
+
+/*
+ * Appends the escaped form of 'str' without quotes. Runs of plain bytes and
+ * valid multi-byte sequences are copied in one go.
+ *
+ * Returns -1 on the first byte which is not valid UTF-8.
+ */
+static int
+append_escaped(json_buf_t *buf, const byte_t *str, size_t len) {
+    size_t run = 0;
+    size_t i = 0;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    while (i < len) {
+        byte_t c = str[i];
+
+        if (is_plain(c)) {
+            i++;
+            continue;
+        }
+
+        if (c >= 0x80) {
+            size_t n = utf8_sequence_len(str + i, len - i);
+
+            if (n == 0) {
+                return -1;
+            }
+
+            i += n;
+            continue;
+        }
+
+        put_bytes(buf, str + run, i - run);
+
+        char escape[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t escape_len = 2;
+
+        switch (c) {
+        case '"':  escape[1] = '"';  break;
+        case '\\': escape[1] = '\\'; break;
+        case '\b': escape[1] = 'b';  break;
+        case '\f': escape[1] = 'f';  break;
+        case '\n': escape[1] = 'n';  break;
+        case '\r': escape[1] = 'r';  break;
+        case '\t': escape[1] = 't';  break;
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = hex_digits[c >> 4];
+            escape[5] = hex_digits[c & 0x0f];
+            escape_len = 6;
+            break;
+        }
+
+        put_bytes(buf, escape, escape_len);
+
+        run = ++i;
+    }
+
+    put_bytes(buf, str + run, len - run);
+
+    return 0;
+}
+
+/*
+ * Appends the base64 encoding of the concatenation of 'count' byte ranges,
+ * without quotes.
+ */
+static void
+append_base64(json_buf_t *buf, const byte_t **parts, const size_t *lens, size_t count) {
+    size_t total = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        total += lens[i];
+    }
+
+    if (reserve(buf, (total + 2) / 3 * 4) != 0) {
+        return;
+    }
+
+    char *out = buf->data + buf->len;
+    uint32_t group = 0;
+    int pending = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < lens[i]; j++) {
+            group = (group << 8) | parts[i][j];
+
+            if (++pending == 3) {
+                *out++ = base64_digits[(group >> 18) & 0x3f];
+                *out++ = base64_digits[(group >> 12) & 0x3f];
+                *out++ = base64_digits[(group >> 6) & 0x3f];
+                *out++ = base64_digits[group & 0x3f];
+                group = 0;
+                pending = 0;
+            }
+        }
+    }
+
+    if (pending == 1) {
+        group <<= 16;
+        *out++ = base64_digits[(group >> 18) & 0x3f];
+        *out++ = base64_digits[(group >> 12) & 0x3f];
+        *out++ = '=';
+        *out++ = '=';
+    } else if (pending == 2) {
+        group <<= 8;
+        *out++ = base64_digits[(group >> 18) & 0x3f];
+        *out++ = base64_digits[(group >> 12) & 0x3f];
+        *out++ = base64_digits[(group >> 6) & 0x3f];
+        *out++ = '=';
+    }
+
+    buf->len = out - buf->data;
+    buf->data[buf->len] = '\0';
+}
+
+/*
+ * Appends the concatenation of 'count' byte ranges as a quoted string,
+ * falling back to base64 if any of them is not valid UTF-8.
+ */
+static int
+append_string_parts(json_buf_t *buf, const byte_t **parts, const size_t *lens, size_t count) {
+    size_t start = buf->len;
+
+    put_literal(buf, "\"");
+
+    for (size_t i = 0; i < count; i++) {
+        if (append_escaped(buf, parts[i], lens[i]) != 0) {
+            buf->len = start;
+            put_literal(buf, "\"");
+            append_base64(buf, parts, lens, count);
+            put_literal(buf, "\"");
+            return 1;
+        }
+    }
+
+    put_literal(buf, "\"");
+
+    return 0;
+}
+
+int
+json_buf_init(json_buf_t *buf, size_t initial) {
+    memset(buf, 0, sizeof(json_buf_t));
+
+    buf->owned = 1;
+
+    if (reserve(buf, initial) != 0) {
+        return ENOMEM;
+    }
+
+    buf->data[0] = '\0';
+
+    return 0;
+}
+
+void
+json_buf_init_fixed(json_buf_t *buf, char *mem, size_t cap) {
+    memset(buf, 0, sizeof(json_buf_t));
+
+    buf->data = mem;
+    buf->cap = cap;
+
+    if (cap > 0) {
+        buf->data[0] = '\0';
+    } else {
+        buf->overflow = 1;
+    }
+}
+
+char *
+json_buf_detach(json_buf_t *buf) {
+    char *data = buf->data;
+
+    if (buf->overflow) {
+        free(data);
+        data = NULL;
+    }
+
+    memset(buf, 0, sizeof(json_buf_t));
+
+    return data;
+}
+
+void
+json_buf_free(json_buf_t *buf) {
+    if (buf->owned) {
+        free(buf->data);
+    }
+
+    memset(buf, 0, sizeof(json_buf_t));
+}
+
+void
+json_buf_append(json_buf_t *buf, const char *str, size_t len) {
+    put_bytes(buf, str, len);
+}
+
+int
+json_buf_append_string(json_buf_t *buf, const byte_t *str, size_t len) {
+    return append_string_parts(buf, &str, &len, 1);
+}
+
+size_t
+json_row_size_hint(size_t key_len, const hb_cell_t **cells, size_t cell_count) {
+    size_t size = JSON_ROW_OVERHEAD + key_len;
+
+    for (size_t i = 0; i < cell_count; i++) {
+        size += JSON_CELL_OVERHEAD + cells[i]->family_len
+                + cells[i]->qualifier_len + cells[i]->value_len;
+    }
+
+    return size;
+}
+
+int
+json_write_row(json_buf_t *buf, const byte_t *key, size_t key_len,
+               const hb_cell_t **cells, size_t cell_count) {
+    static const byte_t name_separator = ':';
+
+    put_literal(buf, "{\"rowkey\":");
+
+    if (json_buf_append_string(buf, key, key_len)) {
+        put_literal(buf, ",\"rowkey_encoding\":\"base64\"");
+    }
+
+    put_literal(buf, ",\"columns\":[");
+
+    for (size_t i = 0; i < cell_count; i++) {
+        const hb_cell_t *cell = cells[i];
+        const byte_t *name[] = { cell->family, &name_separator, cell->qualifier };
+        const size_t name_lens[] = { cell->family_len, 1, cell->qualifier_len };
+
+        if (i != 0) {
+            put_literal(buf, ",");
+        }
+
+        put_literal(buf, "{\"name\":");
+
+        if (append_string_parts(buf, name, name_lens, 3)) {
+            put_literal(buf, ",\"name_encoding\":\"base64\"");
+        }
+
+        put_literal(buf, ",\"value\":");
+
+        if (json_buf_append_string(buf, cell->value, cell->value_len)) {
+            put_literal(buf, ",\"encoding\":\"base64\"");
+        }
+
+        put_literal(buf, "}");
+    }
+
+    put_literal(buf, "]}");
+
+    if (buf->overflow) {
+        return buf->owned ? ENOMEM : ENOBUFS;
+    }
+
+    return 0;
+}
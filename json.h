@@ -0,0 +1,105 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_JSON_H_
+#define HEDIS_CONNECTOR_JSON_H_
+
+#include <stddef.h>
+
+#include <hbase/types.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * Output buffer of the serializer. A buffer either owns its memory and grows
+ * on demand, or writes into caller memory of a fixed size and records an
+ * overflow once that is exhausted. The content is always NUL terminated.
+ */
+typedef struct json_buf_t_ {
+    char *data;
+    size_t len;
+    size_t cap;
+    int owned;
+    int overflow;
+} json_buf_t;
+
+/**
+ * Sets up a growable buffer with room for at least 'initial' bytes.
+ *
+ * @returns 0 on success, ENOMEM otherwise.
+ */
+int
+json_buf_init(json_buf_t *buf, size_t initial);
+
+/**
+ * Sets up a buffer writing into 'mem', which holds 'cap' bytes.
+ */
+void
+json_buf_init_fixed(json_buf_t *buf, char *mem, size_t cap);
+
+/**
+ * Hands the content of a growable buffer over to the caller, who frees it.
+ *
+ * @returns NULL if the buffer ran out of memory.
+ */
+char *
+json_buf_detach(json_buf_t *buf);
+
+void
+json_buf_free(json_buf_t *buf);
+
+void
+json_buf_append(json_buf_t *buf, const char *str, size_t len);
+
+/**
+ * Appends 'len' bytes as a quoted JSON string. Bytes which are not valid
+ * UTF-8 make it write the base64 encoding instead.
+ *
+ * @returns 0 for a text string, 1 for a base64 encoded one.
+ */
+int
+json_buf_append_string(json_buf_t *buf, const byte_t *str, size_t len);
+
+/**
+ * @returns an upper bound of the size of a row in the common case, to size
+ * the buffer up front.
+ */
+size_t
+json_row_size_hint(size_t key_len, const hb_cell_t **cells, size_t cell_count);
+
+/**
+ * Serializes a row as
+ *
+ *   {"rowkey":"...","columns":[{"name":"family:qualifier","value":"..."}]}
+ *
+ * A rowkey, name or value which is not valid UTF-8 is base64 encoded and
+ * flagged with a sibling "rowkey_encoding", "name_encoding" or "encoding"
+ * member set to "base64".
+ *
+ * @returns 0 on success, ENOMEM or ENOBUFS if the buffer ran out of space.
+ */
+int
+json_write_row(json_buf_t *buf, const byte_t *key, size_t key_len,
+               const hb_cell_t **cells, size_t cell_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_JSON_H_ */
@@ -15,6 +15,8 @@
 * See the License for the specific language governing permissions and
 * limitations under the License.
 */
+#define _POSIX_C_SOURCE 200809L
+
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
@@ -26,13 +28,19 @@
 #include <stdbool.h>
 #include <time.h>
 #include <unistd.h>
-#include <regex.h>
 
 #include <hbase/hbase.h>
 
 /* Found under /libhbase/src/test/native/common */
 #include <byte_buffer.h>
 #include "hedis.h"
+#include "cache.h"
+#include "command.h"
+#include "json.h"
+#include "miss_filter.h"
+#include "pool.h"
+#include "stats.h"
+#include "timer.h"
 
 #line __LINE__ "main.c"
 
@@ -47,14 +55,8 @@ extern  "C" {
 #define CHECK_API_ERROR(retCode, ...) \
     HBASE_LOG_MSG((retCode ? HBASE_LOG_LEVEL_ERROR : HBASE_LOG_LEVEL_INFO), \
         __VA_ARGS__, retCode);
-// test REGEX: https://regex101.com/r/bB3mQ1/4
-#define HEDIS_COMMAND_PATTERN "([a-zA-Z0-9_\\-]+)@([#:a-zA-Z0-9_\\\\\\-]+)(@([@#a-zA-Z0-9_\\\\\\-]+)(:([a-zA-Z0-9_\\-]+))?)?"
-#define HEDIS_COMMAND_LENGTH 6
-#define HEDIS_COMMAND_TABLE_INDEX 0
-#define HEDIS_COMMAND_ROWKEY_INDEX 1
-#define HEDIS_COMMAND_COLUMN_FAMILY_INDEX 3
-#define HEDIS_COMMAND_COLUMN_QUALIFIER_INDEX 5
-#define MAX_ERROR_MSG 0x1000
+#define HEDIS_ROWKEY_SEPARATOR ','
+#define HEDIS_STATS_COMMAND "@stats"
 
 typedef struct cell_data_t_ {
     bytebuffer value;
@@ -92,423 +94,2496 @@ release_row_data(row_data_t *row_data) {
 
 hedisConfigEntry **hedis_entries;
 int hedis_entry_count;
-regex_t *r = NULL;
-char *value;
-char *char_rowkey = NULL;
-char *char_family = NULL;
-char *char_qualifier = NULL;
-bytebuffer byte_rowkey = NULL;
-bytebuffer byte_family = NULL;
-bytebuffer byte_qualifier = NULL;
 char *connector_zookeeper = NULL;
-hb_connection_t connection = NULL;
-hb_client_t client = NULL;
-
-char *convert(const byte_t *src, size_t length) {
-    char *result = malloc(sizeof(char) * length);
-
-    sprintf(result, "%.*s", length, src);
-
-    return result;
-}
-
-void printRow(const hb_result_t result) {
-    const byte_t *key = NULL;
-    size_t key_len = 0;
-    hb_result_get_key(result, &key, &key_len);
-    size_t cell_count = 0;
-    hb_result_get_cell_count(result, &cell_count);
-    HBASE_LOG_INFO("Row=\'%.*s\', cell count=%d", key_len, key, cell_count);
-    const hb_cell_t **cells;
-    hb_result_get_cells(result, &cells, &cell_count);
-    for (size_t i = 0; i < cell_count; ++i) {
-        HBASE_LOG_INFO(
-            "Cell %d: family=\'%.*s\', qualifier=\'%.*s\', "
-            "value=\'%.*s\', timestamp=%lld.", i,
-            cells[i]->family_len, cells[i]->family,
-            cells[i]->qualifier_len, cells[i]->qualifier,
-            cells[i]->value_len, cells[i]->value, cells[i]->ts);
-    }
-}
+long coalesce_window_us = 0;
+long cache_ttl_ms = 1000;
+size_t cache_max_entries = 0;
+size_t cache_max_bytes = 0;
+size_t cache_shards = 16;
+size_t scan_batch_rows = 100;
+size_t scan_prefetch = 2;
+size_t scan_max_rows = 0;
+size_t write_batch_mutations = 100;
+size_t write_batch_bytes = 1 << 20;
+long write_batch_ms = 5;
+HBaseLogLevel log_level = HBASE_LOG_LEVEL_INFO;
+char *warmup_tables = NULL;
+long warmup_timeout_ms = 10000;
+long request_timeout_ms = 0;
+double hedge_percentile = 0;
+long hedge_min_delay_us = 1000;
+size_t miss_filter_bytes = 0;
+size_t miss_exact_entries = 0;
+long miss_ttl_ms = 1000;
+FILE *logFile = NULL;
 
-char * to_json(const hb_result_t result) {
+/**
+ * Serializes 'result' into '*value', which is set to NULL if the row is
+ * missing.
+ *
+ * @returns 0 on success, ENOMEM if the JSON could not be allocated
+ */
+int to_json(const hb_result_t result, char **value) {
     const byte_t *key = NULL;
     size_t key_len = 0;
 
-    char *json;
-
-    json = malloc(sizeof(char) * 200);
+    *value = NULL;
 
     hb_result_get_key(result, &key, &key_len);
 
     if (key == NULL) {
-        return NULL;
+        return 0;
     }
 
+    const hb_cell_t **cells = NULL;
     size_t cell_count = 0;
-
-    hb_result_get_cell_count(result, &cell_count);
-
-    const hb_cell_t **cells;
+    uint64_t start = stats_now();
 
     hb_result_get_cells(result, &cells, &cell_count);
 
-    // show JSON: {"rowkey":"thisisrowkey","columns":[{"name":"cf:gu","value":"M0000001"},{"name":"cf:nk","value":"kewang"}]}
-    strcpy(json, "{\"rowkey\":\"");
+    uint64_t encode_start = stats_now();
+    json_buf_t json;
 
-    strcat(json, convert(key, key_len));
-    strcat(json, "\",\"columns\":[");
+    stats_record(STATS_RESULT, encode_start - start);
 
-    for (size_t i = 0; i < cell_count; i++) {
-        strcat(json, "{\"name\":\"");
-        strcat(json, convert(cells[i]->family, cells[i]->family_len));
-        strcat(json, ":");
-        strcat(json, convert(cells[i]->qualifier, cells[i]->qualifier_len));
-        strcat(json, "\",\"value\":\"");
-        strcat(json, convert(cells[i]->value, cells[i]->value_len));
-        strcat(json, "\"},");
+    if (json_buf_init(&json, json_row_size_hint(key_len, cells, cell_count)) != 0) {
+        return ENOMEM;
     }
 
-    int json_length = strlen(json);
+    json_write_row(&json, key, key_len, cells, cell_count);
 
-    memmove(&json[json_length - 1], &json[json_length], 1);
+    stats_record_since(STATS_JSON, encode_start);
+    stats_add(STATS_BYTES_RETURNED, json.len);
 
-    strcat(json, "]}");
+    *value = json_buf_detach(&json);
 
-    return json;
+    return *value != NULL ? 0 : ENOMEM;
 }
 
 /**
- * Get synchronizer and callback
+ * Client pool
+ *
+ * 'client_pool_size' clients, spread round-robin over
+ * 'client_pool_connections' connections, share the traffic. A get or scan
+ * goes to the client with the fewest RPCs in flight, or with
+ * "client_dispatch: hash" to the client its rowkey hashes to, so that the
+ * requests of one row stay in order on one client.
+ *
+ * With 'client_max_in_flight' set, a caller blocks while the client it is
+ * dispatched to has that many RPCs outstanding, and a least-loaded dispatch
+ * takes the first client to free up. Gets, the first fetch of a scan and
+ * the flush of a write batch wait; later fetches of an admitted scan are
+ * counted but never wait, so a callback thread is never blocked.
+ *
+ * Writes are batched per client. They follow the rowkey hash like gets do,
+ * or else join the batch already open, whichever client it is on.
  */
-volatile bool get_done = false;
-pthread_cond_t get_cv = PTHREAD_COND_INITIALIZER;
-pthread_mutex_t get_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define CLIENT_ANY SIZE_MAX
+
+typedef struct pooled_client_t_ {
+    hb_connection_t connection;
+    hb_client_t client;
+    long in_flight;
+    struct write_batch_t_ *open_write_batch;
+} pooled_client_t;
+
+pooled_client_t *client_pool = NULL;
+size_t client_pool_size = 1;
+size_t client_pool_connections = 1;
+bool client_dispatch_hash = false;
+long client_max_in_flight = 0;
+long client_pool_waiters = 0;
+size_t client_pool_next = 0;
+pthread_cond_t client_pool_cv = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t client_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-void
-get_callback(int32_t err, hb_client_t client,
-             hb_get_t get, hb_result_t result, void *extra) {
-    if (err == 0) {
-        const char *table_name;
-        size_t table_name_len;
-        hb_result_get_table(result, &table_name, &table_name_len);
-        HBASE_LOG_INFO("Received get callback for table=\'%.*s\'.",
-                       table_name_len, table_name);
+/**
+ * @returns the client a request of 'rowkey' must go to, or CLIENT_ANY when
+ * it may go to any of them
+ */
+size_t
+client_slot(const char *rowkey, size_t rowkey_len) {
+    if (!client_dispatch_hash || client_pool_size == 1) {
+        return CLIENT_ANY;
+    }
 
-        printRow(result);
+    uint64_t hash = 14695981039346656037ULL;
 
-        value = to_json(result);
+    for (size_t i = 0; i < rowkey_len; i++) {
+        hash ^= (unsigned char) rowkey[i];
+        hash *= 1099511628211ULL;
+    }
 
-        printf("value: %s\n", value);
+    return hash % client_pool_size;
+}
 
-        hb_result_destroy(result);
-    } else {
-        HBASE_LOG_ERROR("Get failed with error code: %d.", err);
-    }
+pooled_client_t *
+least_loaded_client() {
+    // ties go round-robin, so an idle pool still spreads its requests
+    size_t first = __sync_fetch_and_add(&client_pool_next, 1) % client_pool_size;
+    pooled_client_t *best = &client_pool[first];
+    long best_in_flight = __atomic_load_n(&best->in_flight, __ATOMIC_RELAXED);
 
-    hb_get_destroy(get);
+    for (size_t i = 1; i < client_pool_size && best_in_flight > 0; i++) {
+        pooled_client_t *pooled = &client_pool[(first + i) % client_pool_size];
+        long in_flight = __atomic_load_n(&pooled->in_flight, __ATOMIC_RELAXED);
+
+        if (in_flight < best_in_flight) {
+            best = pooled;
+            best_in_flight = in_flight;
+        }
+    }
 
-    pthread_mutex_lock(&get_mutex);
-    get_done = true;
-    pthread_cond_signal(&get_cv);
-    pthread_mutex_unlock(&get_mutex);
+    return best;
 }
 
-void
-wait_for_get() {
-    HBASE_LOG_INFO("Waiting for get operation to complete.");
-    pthread_mutex_lock(&get_mutex);
-    while (!get_done) {
-        pthread_cond_wait(&get_cv, &get_mutex);
+bool
+try_acquire_client(pooled_client_t *pooled) {
+    if (client_max_in_flight <= 0) {
+        __sync_add_and_fetch(&pooled->in_flight, 1);
+
+        return true;
+    }
+
+    long in_flight = __atomic_load_n(&pooled->in_flight, __ATOMIC_RELAXED);
+
+    while (in_flight < client_max_in_flight) {
+        if (__atomic_compare_exchange_n(&pooled->in_flight, &in_flight, in_flight + 1, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            return true;
+        }
     }
-    pthread_mutex_unlock(&get_mutex);
-    HBASE_LOG_INFO("Get operation completed.");
+
+    return false;
 }
 
 /**
- * Scan synchronizer and callbacks
+ * Takes an in-flight slot on client 'slot', or on the least loaded client
+ * if it is CLIENT_ANY, waiting for one to free up if need be. Every slot is
+ * given back with release_client().
  */
-volatile bool scan_done = false;
-pthread_cond_t scan_cv = PTHREAD_COND_INITIALIZER;
-pthread_mutex_t scan_mutex = PTHREAD_MUTEX_INITIALIZER;
+pooled_client_t *
+acquire_client(size_t slot) {
+    pooled_client_t *pooled = slot == CLIENT_ANY ? least_loaded_client() : &client_pool[slot];
 
-void scan_callback(int32_t err, hb_scanner_t scanner,
-                   hb_result_t results[], size_t num_results, void *extra) {
-    if (num_results) {
-        const char *table_name;
-        size_t table_name_len;
-        hb_result_get_table(results[0], &table_name, &table_name_len);
-        HBASE_LOG_INFO("Received scan_next callback for table=\'%.*s\', row count=%d.",
-                       table_name_len, table_name, num_results);
-
-        for (int i = 0; i < num_results; ++i) {
-            printRow(results[i]);
-            hb_result_destroy(results[i]);
-        }
-        hb_scanner_next(scanner, scan_callback, NULL);
-    } else {
-        hb_scanner_destroy(scanner, NULL, NULL);
-        pthread_mutex_lock(&scan_mutex);
-        scan_done = true;
-        pthread_cond_signal(&scan_cv);
-        pthread_mutex_unlock(&scan_mutex);
+    if (try_acquire_client(pooled)) {
+        return pooled;
     }
-}
 
-void
-wait_for_scan() {
-    HBASE_LOG_INFO("Waiting for scan to complete.");
-    pthread_mutex_lock(&scan_mutex);
-    while (!scan_done) {
-        pthread_cond_wait(&scan_cv, &scan_mutex);
+    pthread_mutex_lock(&client_pool_mutex);
+    __sync_add_and_fetch(&client_pool_waiters, 1);
+
+    for (;;) {
+        pooled = slot == CLIENT_ANY ? least_loaded_client() : &client_pool[slot];
+
+        if (try_acquire_client(pooled)) {
+            break;
+        }
+
+        pthread_cond_wait(&client_pool_cv, &client_pool_mutex);
     }
-    pthread_mutex_unlock(&scan_mutex);
-    HBASE_LOG_INFO("Scan completed.");
+
+    __sync_sub_and_fetch(&client_pool_waiters, 1);
+    pthread_mutex_unlock(&client_pool_mutex);
+
+    return pooled;
 }
 
 /**
- * Client destroy synchronizer and callbacks
+ * Takes an in-flight slot on 'pooled' whatever its bound, for the follow-up
+ * RPCs of a request already admitted.
  */
-volatile bool client_destroyed = false;
-pthread_cond_t client_destroyed_cv = PTHREAD_COND_INITIALIZER;
-pthread_mutex_t client_destroyed_mutex = PTHREAD_MUTEX_INITIALIZER;
-
 void
-client_disconnection_callback(int32_t err,
-                              hb_client_t client, void *extra) {
-    HBASE_LOG_INFO("Received client disconnection callback.");
-    pthread_mutex_lock(&client_destroyed_mutex);
-    client_destroyed = true;
-    pthread_cond_signal(&client_destroyed_cv);
-    pthread_mutex_unlock(&client_destroyed_mutex);
+hold_client(pooled_client_t *pooled) {
+    __sync_add_and_fetch(&pooled->in_flight, 1);
 }
 
 void
-wait_client_disconnection() {
-    HBASE_LOG_INFO("Waiting for client to disconnect.");
-    pthread_mutex_lock(&client_destroyed_mutex);
-    while (!client_destroyed) {
-        pthread_cond_wait(&client_destroyed_cv, &client_destroyed_mutex);
+release_client(pooled_client_t *pooled) {
+    __sync_sub_and_fetch(&pooled->in_flight, 1);
+
+    // a waiter registers before its last try, so it cannot miss this
+    if (client_max_in_flight > 0 && __sync_add_and_fetch(&client_pool_waiters, 0) > 0) {
+        pthread_mutex_lock(&client_pool_mutex);
+        pthread_cond_broadcast(&client_pool_cv);
+        pthread_mutex_unlock(&client_pool_mutex);
     }
-    pthread_mutex_unlock(&client_destroyed_mutex);
-    HBASE_LOG_INFO("Client disconnected.");
 }
 
 int
-ensureTable(hb_connection_t connection, const char *table_name) {
+create_client_pool() {
     int32_t retCode = 0;
-    hb_admin_t admin = NULL;
 
-    if ((retCode = hb_admin_create(connection, &admin)) != 0) {
-        HBASE_LOG_ERROR("Could not create HBase admin : errorCode = %d.", retCode);
+    client_pool = calloc(client_pool_size, sizeof(pooled_client_t));
 
-        goto cleanup;
+    if (client_pool == NULL) {
+        return ENOMEM;
     }
 
-    if ((retCode = hb_admin_table_exists(admin, NULL, table_name)) == 0) {
-        HBASE_LOG_INFO("Table '%s' exists", table_name);
-    } else if (retCode != ENOENT) {
-        HBASE_LOG_ERROR("Error while checking if the table exists: errorCode = %d.", retCode);
-    }
+    for (size_t i = 0; i < client_pool_size; i++) {
+        pooled_client_t *pooled = &client_pool[i];
 
-cleanup:
-    if (admin) {
-        hb_admin_destroy(admin, NULL, NULL);
+        if (i < client_pool_connections) {
+            if ((retCode = hb_connection_create(connector_zookeeper, NULL,
+                                                &pooled->connection)) != 0) {
+                HBASE_LOG_ERROR("Could not create HBase connection : errorCode = %d.", retCode);
+
+                return retCode;
+            }
+        } else {
+            pooled->connection = client_pool[i % client_pool_connections].connection;
+        }
+
+        if ((retCode = hb_client_create(pooled->connection, &pooled->client)) != 0) {
+            HBASE_LOG_ERROR("Could not connect to HBase cluster : errorCode = %d.", retCode);
+
+            return retCode;
+        }
     }
 
-    return retCode;
+    return 0;
 }
 
-int init(hedisConfigEntry **entries, int entry_count) {
-    hedis_entries = entries;
-    hedis_entry_count = entry_count;
+/**
+ * Get request and callback
+ *
+ * Every lookup owns a get_request_t which travels to get_callback() through
+ * the 'extra' argument of hb_get_send(), so any number of lookups can be in
+ * flight on the client pool at the same time.
+ *
+ * A lookup may also arm a deadline, which completes it with ETIMEDOUT, and a
+ * hedge, which sends a second identical get if the first has not answered in
+ * time. Whichever completes the request first invokes its callback; the
+ * others find it done and drop what they carry. The request is freed once
+ * its gets have answered and its timers have run or been cancelled.
+ *
+ * Requests whose rowkey fits in GET_REQUEST_POOLED_ROWKEY bytes come from
+ * get_request_pool, and go back to it when freed.
+ */
+typedef struct get_rpc_t_ {
+    struct get_request_t_ *request;
+    pooled_client_t *pooled;
+    uint64_t start;             /* when it was sent */
+} get_rpc_t;
+
+typedef struct get_request_t_ {
+    hedis_value_cb cb;
+    void *extra;
+    char *cache_key;
+    size_t cache_key_len;
+    uint32_t cache_version;     /* of the row when the get was sent */
+    uint64_t start;             /* when it was queued */
+    int refs;                   /* gets and timers pending, plus the sender's */
+    int rpcs;                   /* gets not answered yet */
+    int done;                   /* 'cb' has been invoked */
+    get_rpc_t rpc[2];           /* the get and its hedge */
+    hedis_timer_t deadline;
+    hedis_timer_t hedge;
+    bool deadline_armed;        /* set before arming, so finish_get() knows */
+    bool hedge_armed;           /* which timers to cancel */
+    const command_plan_t *plan; /* kept for the hedge */
+    miss_key_t miss_key;
+    uint32_t miss_version;      /* of the row when the lookup started */
+    size_t rowkey_len;
+    char rowkey[];
+} get_request_t;
+
+#define GET_REQUEST_POOLED_ROWKEY 128
+
+object_pool_t get_request_pool =
+    OBJECT_POOL_INITIALIZER(sizeof(get_request_t) + GET_REQUEST_POOLED_ROWKEY);
+
+#define HEDGE_MIN_SAMPLES 1000
+#define HEDGE_REFRESH_NS 1000000000ULL
+
+uint64_t hedge_delay_ns = 0;
+uint64_t hedge_refreshed = 0;
 
-    r = malloc(sizeof(regex_t));
+void
+release_get_request(get_request_t *request) {
+    if (__sync_sub_and_fetch(&request->refs, 1) != 0) {
+        return;
+    }
 
-    int status = regcomp(r, HEDIS_COMMAND_PATTERN, REG_EXTENDED | REG_NEWLINE);
+    command_plan_release(request->plan);
+    free(request->cache_key);
 
-    if (status != 0) {
-        char error_message[MAX_ERROR_MSG];
+    if (request->rowkey_len <= GET_REQUEST_POOLED_ROWKEY) {
+        object_pool_put(&get_request_pool, request);
+    } else {
+        free(request);
+    }
+}
 
-        regerror(status, r, error_message, MAX_ERROR_MSG);
+/**
+ * Completes 'request' with 'err' and 'value' unless something else already
+ * has, in which case 'value' is freed.
+ *
+ * @returns true if this completed the request
+ */
+bool
+finish_get(get_request_t *request, int err, char *value) {
+    if (!__sync_bool_compare_and_swap(&request->done, 0, 1)) {
+        free(value);
 
-        printf("Regex error compiling '%s': %s\n", HEDIS_COMMAND_PATTERN, error_message);
+        return false;
+    }
 
-        return -1;
+    // a timer removed before it ran gives its reference back here; timers
+    // never armed are skipped, as timer_cancel() takes the timer lock
+    if (__atomic_load_n(&request->deadline_armed, __ATOMIC_ACQUIRE)
+        && timer_cancel(&request->deadline)) {
+        release_get_request(request);
     }
 
-    for (int i = 0; i < hedis_entry_count; i++) {
-        if (!strcasecmp(hedis_entries[i]->key, "zookeeper")) {
-            connector_zookeeper = malloc(sizeof(char) * (strlen(hedis_entries[i]->value) + 1));
+    if (__atomic_load_n(&request->hedge_armed, __ATOMIC_ACQUIRE)
+        && timer_cancel(&request->hedge)) {
+        release_get_request(request);
+    }
 
-            strcpy(connector_zookeeper, hedis_entries[i]->value);
+    request->cb(err, value, request->extra);
 
-            break;
-        }
+    return true;
+}
+
+void
+get_callback(int32_t err, hb_client_t client,
+             hb_get_t get, hb_result_t result, void *extra) {
+    get_rpc_t *rpc = (get_rpc_t *) extra;
+    get_request_t *request = rpc->request;
+    char *value = NULL;
+
+    stats_record_since(STATS_RPC, rpc->start);
+    stats_add(STATS_RPCS_IN_FLIGHT, -1);
+    release_client(rpc->pooled);
+
+    // an answer nobody waits for any more is not serialized
+    if (err == 0 && !__atomic_load_n(&request->done, __ATOMIC_ACQUIRE)) {
+        err = to_json(result, &value);
     }
 
-    int32_t retCode = 0;
+    if (err == 0) {
+        if (value != NULL && request->cache_key != NULL) {
+            row_cache_put(request->cache_key, request->cache_key_len, value,
+                          request->cache_version);
+        }
 
-    if ((retCode = hb_connection_create(connector_zookeeper,
-                                        NULL,
-                                        &connection)) != 0) {
-        HBASE_LOG_ERROR("Could not create HBase connection : errorCode = %d.", retCode);
+        if (value == NULL && result != NULL && miss_filter_enabled()) {
+            const byte_t *key = NULL;
+            size_t key_len = 0;
 
-        return -1;
+            hb_result_get_key(result, &key, &key_len);
+
+            if (key == NULL) {
+                miss_filter_add(&request->miss_key, request->miss_version);
+                stats_add(STATS_MISS_INSERTS, 1);
+            }
+        }
+    } else {
+        HBASE_LOG_ERROR("Get failed with error code: %d.", err);
+
+        stats_error(err);
     }
 
-    HBASE_LOG_INFO("Connecting to HBase cluster using Zookeeper ensemble '%s'.",
-                   connector_zookeeper);
+    if (result) {
+        hb_result_destroy(result);
+    }
 
-    if ((retCode = hb_client_create(connection, &client)) != 0) {
-        HBASE_LOG_ERROR("Could not connect to HBase cluster : errorCode = %d.", retCode);
+    hb_get_destroy(get);
 
-        return -1;
+    // a failure is only reported once the other get has failed too
+    if (__sync_sub_and_fetch(&request->rpcs, 1) == 0 || err == 0) {
+        if (finish_get(request, err, value) && rpc != &request->rpc[0]) {
+            stats_add(STATS_HEDGE_WINS, 1);
+        }
     }
 
-    return 0;
+    release_get_request(request);
 }
 
-int parse_hedis_command(const char * to_match, char ** str) {
-    /* "P" is a pointer into the string which points to the end of the
-     *        previous match. */
-    const char * p = to_match;
-    /* "N_matches" is the maximum number of matches allowed. */
-    const int n_matches = HEDIS_COMMAND_LENGTH + 1;
-    /* "M" contains the matches found. */
-    regmatch_t m[n_matches];
+/**
+ * Sends 'get' for 'request' on a client slot already taken, for a reference
+ * and an 'rpcs' count the caller took. A get which cannot be sent, or which
+ * is no longer needed, is answered on the spot.
+ */
+void
+send_get(get_request_t *request, get_rpc_t *rpc, pooled_client_t *pooled, hb_get_t get) {
+    if (__atomic_load_n(&request->done, __ATOMIC_ACQUIRE)) {
+        release_client(pooled);
+        hb_get_destroy(get);
+        __sync_sub_and_fetch(&request->rpcs, 1);
+        release_get_request(request);
+
+        return;
+    }
 
-    int i = 0;
-    int nomatch = regexec(r, p, n_matches, m, 0);
+    // the callback may free the request before hb_get_send() returns
+    uint64_t start = stats_now();
 
-    if (nomatch) {
-        printf("No more matches.\n");
+    rpc->request = request;
+    rpc->start = start;
+    __atomic_store_n(&rpc->pooled, pooled, __ATOMIC_RELEASE);
+    stats_add(STATS_RPCS_IN_FLIGHT, 1);
 
-        return -1;
-    }
+    int32_t retCode = hb_get_send(pooled->client, get, get_callback, rpc);
 
-    for (i = 0; i < n_matches; i++) {
-        int start;
-        int finish;
+    stats_record_since(STATS_SEND, start);
 
-        if (m[i].rm_so == -1) {
-            break;
-        }
+    if (retCode != 0) {
+        HBASE_LOG_ERROR("Could not send get : errorCode = %d.", retCode);
 
-        start = m[i].rm_so + (p - to_match);
-        finish = m[i].rm_eo + (p - to_match);
+        get_callback(retCode, pooled->client, get, NULL, rpc);
+    }
+}
 
-        if (i != 0) {
-            int size = finish - start;
+/**
+ * Answers a get of 'request' which could not be sent with 'err', for the
+ * reference and 'rpcs' count the caller took, as send_get() would have.
+ */
+void
+fail_get(get_request_t *request, hb_get_t get, int err) {
+    HBASE_LOG_ERROR("Could not send get : errorCode = %d.", err);
 
-            str[i - 1] = malloc(sizeof(char) * (size + 1));
+    stats_error(err);
+    hb_get_destroy(get);
 
-            sprintf(str[i - 1], "%.*s", size, to_match + start);
-        }
+    if (__sync_sub_and_fetch(&request->rpcs, 1) == 0) {
+        finish_get(request, err, NULL);
     }
 
-    p += m[0].rm_eo;
+    release_get_request(request);
+}
+
+void
+get_deadline_callback(hedis_timer_t *timer) {
+    get_request_t *request = (get_request_t *) ((char *) timer - offsetof(get_request_t, deadline));
+
+    if (finish_get(request, ETIMEDOUT, NULL)) {
+        stats_error(ETIMEDOUT);
+    }
 
-    return i - 1;
+    release_get_request(request);
 }
 
-char *get_value(const char *str) {
-    char **commands = malloc(sizeof(char *) * HEDIS_COMMAND_LENGTH);
+hb_get_t
+create_get(const command_plan_t *plan, const char *rowkey, size_t rowkey_len) {
+    int32_t retCode = 0;
+    hb_get_t get = NULL;
 
-    int command_length = parse_hedis_command(str, commands);
+    if ((retCode = hb_get_create((const byte_t *)rowkey, rowkey_len, &get)) != 0) {
+        HBASE_LOG_ERROR("Could not create get : errorCode = %d.", retCode);
 
-    if (command_length == -1) {
         return NULL;
     }
 
-    int32_t retCode = 0;
-    FILE* logFile = NULL;
+    if (plan->family != NULL) {
+        hb_get_add_column(get, (byte_t *)plan->family, plan->family_len,
+                          (byte_t *)plan->qualifier, plan->qualifier_len);
+    }
+
+    hb_get_set_table(get, plan->table, plan->table_len);
+    hb_get_set_num_versions(get, 10); // up to ten versions of each column
+
+    return get;
+}
 
-    // reinitialize pthread
-    get_cv = (pthread_cond_t)PTHREAD_COND_INITIALIZER;
-    get_mutex = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
-    client_destroyed_cv = (pthread_cond_t)PTHREAD_COND_INITIALIZER;
-    client_destroyed_mutex = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+void
+get_hedge_callback(hedis_timer_t *timer) {
+    get_request_t *request = (get_request_t *) ((char *) timer - offsetof(get_request_t, hedge));
 
-    char_rowkey = commands[HEDIS_COMMAND_ROWKEY_INDEX];
+    if (__atomic_load_n(&request->done, __ATOMIC_ACQUIRE)) {
+        release_get_request(request);
 
-    if (command_length >= HEDIS_COMMAND_COLUMN_FAMILY_INDEX + 1) {
-        char_family = commands[HEDIS_COMMAND_COLUMN_FAMILY_INDEX];
-        byte_family = bytebuffer_strcpy(char_family);
+        return;
     }
 
-    if (command_length >= HEDIS_COMMAND_COLUMN_QUALIFIER_INDEX + 1) {
-        char_qualifier = commands[HEDIS_COMMAND_COLUMN_QUALIFIER_INDEX];
-        byte_qualifier = bytebuffer_strcpy(char_qualifier);
+    // another client than the first get's, if it has room; the timer thread
+    // never waits for one
+    pooled_client_t *pooled = least_loaded_client();
+
+    if (pooled == __atomic_load_n(&request->rpc[0].pooled, __ATOMIC_ACQUIRE)
+        && client_pool_size > 1) {
+        pooled = &client_pool[(pooled - client_pool + 1) % client_pool_size];
     }
 
-    byte_rowkey = bytebuffer_strcpy(char_rowkey);
+    if (try_acquire_client(pooled)) {
+        hb_get_t get = create_get(request->plan, request->rowkey, request->rowkey_len);
 
-    const char *table_name = commands[HEDIS_COMMAND_TABLE_INDEX];
-    const size_t table_name_len = strlen(table_name);
+        if (get != NULL) {
+            stats_add(STATS_HEDGES, 1);
+            __sync_add_and_fetch(&request->rpcs, 1);
+            __sync_add_and_fetch(&request->refs, 1);
+            send_get(request, &request->rpc[1], pooled, get);
+        } else {
+            release_client(pooled);
+        }
+    }
 
-    hb_log_set_level(HBASE_LOG_LEVEL_DEBUG); // defaults to INFO
-    const char *logFilePath = getenv("HBASE_LOG_FILE");
-    if (logFilePath != NULL) {
-        FILE* logFile = fopen(logFilePath, "a");
-        if (!logFile) {
-            retCode = errno;
-            fprintf(stderr, "Unable to open log file \"%s\"", logFilePath);
-            perror(NULL);
+    release_get_request(request);
+}
+
+/**
+ * @returns how long a get waits before it is hedged: the 'hedge_percentile'th
+ * RPC latency since process start, at least 'hedge_min_delay_us', or 0 while
+ * fewer than HEDGE_MIN_SAMPLES RPCs have been timed. The percentile is
+ * refreshed every HEDGE_REFRESH_NS by whichever caller notices first.
+ */
+uint64_t
+hedge_delay() {
+    uint64_t now = stats_now();
+    uint64_t refreshed = __atomic_load_n(&hedge_refreshed, __ATOMIC_RELAXED);
+
+    if (now - refreshed >= HEDGE_REFRESH_NS
+        && __sync_bool_compare_and_swap(&hedge_refreshed, refreshed, now)) {
+        stats_histogram_t *rpc = malloc(sizeof(stats_histogram_t));
+        uint64_t delay = 0;
+
+        if (rpc != NULL) {
+            stats_stage_snapshot(STATS_RPC, rpc);
 
-            goto cleanup;
+            if (rpc->count >= HEDGE_MIN_SAMPLES) {
+                delay = stats_percentile(rpc, hedge_percentile);
+
+                if (delay < (uint64_t) hedge_min_delay_us * 1000) {
+                    delay = (uint64_t) hedge_min_delay_us * 1000;
+                }
+            }
+
+            free(rpc);
         }
-        hb_log_set_stream(logFile); // defaults to stderr
+
+        __atomic_store_n(&hedge_delay_ns, delay, __ATOMIC_RELAXED);
     }
 
-    // fetch a row with rowkey
-    hb_get_t get = NULL;
-    hb_get_create(byte_rowkey->buffer, byte_rowkey->length, &get);
+    return __atomic_load_n(&hedge_delay_ns, __ATOMIC_RELAXED);
+}
 
-    if (char_family != NULL) {
-        if (char_qualifier == NULL) {
-            hb_get_add_column(get, (byte_t *)char_family, strlen(char_family), NULL, 0);
-        } else {
-            hb_get_add_column(get, (byte_t *)char_family, strlen(char_family), (byte_t *)char_qualifier, strlen(char_qualifier));
+/**
+ * Get synchronizer used by the blocking calls
+ *
+ * A caller which gives up at its deadline leaves the context to the
+ * callback, so the two share it and whichever lets go last gives it back to
+ * get_context_pool.
+ */
+typedef struct get_context_t_ {
+    bool done;
+    int err;
+    char *value;
+    uint64_t completed;
+    int refs;
+    pthread_cond_t cv;
+    pthread_mutex_t mutex;
+} get_context_t;
+
+object_pool_t get_context_pool = OBJECT_POOL_INITIALIZER(sizeof(get_context_t));
+
+get_context_t *
+new_get_context() {
+    get_context_t *ctx = object_pool_get(&get_context_pool);
+    pthread_condattr_t attr;
+
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    ctx->done = false;
+    ctx->err = 0;
+    ctx->value = NULL;
+    ctx->completed = 0;
+    ctx->refs = 2;
+
+    // deadlines are stats_now() timestamps
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ctx->cv, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&ctx->mutex, NULL);
+
+    return ctx;
+}
+
+void
+release_get_context(get_context_t *ctx) {
+    if (__sync_sub_and_fetch(&ctx->refs, 1) != 0) {
+        return;
+    }
+
+    // left here by a callback which came too late
+    free(ctx->value);
+
+    pthread_cond_destroy(&ctx->cv);
+    pthread_mutex_destroy(&ctx->mutex);
+    object_pool_put(&get_context_pool, ctx);
+}
+
+void
+get_value_callback(int err, char *value, void *extra) {
+    get_context_t *ctx = (get_context_t *) extra;
+
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->err = err;
+    ctx->value = value;
+    ctx->completed = stats_now();
+    ctx->done = true;
+    pthread_cond_signal(&ctx->cv);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    release_get_context(ctx);
+}
+
+/**
+ * Waits for the callback until 'deadline', a stats_now() timestamp or 0 for
+ * none, and takes the value it left if 'value' is not NULL.
+ *
+ * @returns the error code of the callback, or ETIMEDOUT
+ */
+int
+wait_for_get(get_context_t *ctx, uint64_t deadline, char **value) {
+    struct timespec until;
+    bool done;
+    int err = ETIMEDOUT;
+
+    until.tv_sec = deadline / 1000000000;
+    until.tv_nsec = deadline % 1000000000;
+
+    pthread_mutex_lock(&ctx->mutex);
+    while (!ctx->done) {
+        if (deadline == 0) {
+            pthread_cond_wait(&ctx->cv, &ctx->mutex);
+        } else if (pthread_cond_timedwait(&ctx->cv, &ctx->mutex, &until) == ETIMEDOUT) {
+            break;
         }
     }
 
-    hb_get_set_table(get, table_name, table_name_len);
-    hb_get_set_num_versions(get, 10); // up to ten versions of each column
+    done = ctx->done;
 
-    get_done = false;
-    hb_get_send(client, get, get_callback, NULL);
-    wait_for_get();
+    if (done) {
+        err = ctx->err;
 
-cleanup:
-    if (logFile) {
-        HBASE_LOG_INFO("Close log file.");
-        fclose(logFile);
+        if (value != NULL) {
+            *value = ctx->value;
+            ctx->value = NULL;
+        }
     }
+    pthread_mutex_unlock(&ctx->mutex);
+
+    if (!done) {
+        stats_add(STATS_TIMEOUTS, 1);
+    } else {
+        stats_record_since(STATS_WAKEUP, ctx->completed);
+    }
+
+    return err;
+}
+
+/**
+ * Client destroy synchronizer and callbacks
+ */
+volatile bool client_destroyed = false;
+pthread_cond_t client_destroyed_cv = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t client_destroyed_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void
+client_disconnection_callback(int32_t err,
+                              hb_client_t client, void *extra) {
+    HBASE_LOG_INFO("Received client disconnection callback.");
+    pthread_mutex_lock(&client_destroyed_mutex);
+    client_destroyed = true;
+    pthread_cond_signal(&client_destroyed_cv);
+    pthread_mutex_unlock(&client_destroyed_mutex);
+}
 
-    if (char_qualifier != NULL) {
-        bytebuffer_free(byte_qualifier);
+void
+wait_client_disconnection() {
+    HBASE_LOG_INFO("Waiting for client to disconnect.");
+    pthread_mutex_lock(&client_destroyed_mutex);
+    while (!client_destroyed) {
+        pthread_cond_wait(&client_destroyed_cv, &client_destroyed_mutex);
     }
+    pthread_mutex_unlock(&client_destroyed_mutex);
+    HBASE_LOG_INFO("Client disconnected.");
+}
 
-    if (char_family != NULL) {
-        bytebuffer_free(byte_family);
+/**
+ * Multi-get batch
+ *
+ * "table@row1,row2,row3@cf:qual" sends one get per rowkey back-to-back and
+ * completes once all of them have answered. The values are returned as a
+ * JSON array in request order, with null for a missing row and
+ * {"error":code} for a failed get.
+ */
+typedef struct multi_get_slot_t_ {
+    struct multi_get_t_ *batch;
+    int err;
+    char *value;
+} multi_get_slot_t;
+
+typedef struct multi_get_t_ {
+    hedis_value_cb cb;
+    void *extra;
+    size_t count;
+    size_t remaining;
+    multi_get_slot_t *slots;
+} multi_get_t;
+
+char *multi_get_to_json(const multi_get_t *batch) {
+    json_buf_t json;
+    size_t length = 2;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        length += (batch->slots[i].value ? strlen(batch->slots[i].value) : 16) + 1;
     }
 
-    for (int i = 0; i < command_length; i++) {
-        free(commands[i]);
+    if (json_buf_init(&json, length) != 0) {
+        return NULL;
     }
 
-    free(commands);
+    json_buf_append(&json, "[", 1);
 
-    bytebuffer_free(byte_rowkey);
+    for (size_t i = 0; i < batch->count; i++) {
+        const multi_get_slot_t *slot = &batch->slots[i];
+
+        if (i != 0) {
+            json_buf_append(&json, ",", 1);
+        }
 
-    pthread_cond_destroy(&get_cv);
-    pthread_mutex_destroy(&get_mutex);
+        if (slot->err != 0) {
+            char error[32];
+            int error_len = snprintf(error, sizeof(error), "{\"error\":%d}", slot->err);
 
-    pthread_cond_destroy(&client_destroyed_cv);
-    pthread_mutex_destroy(&client_destroyed_mutex);
+            json_buf_append(&json, error, error_len);
+        } else if (slot->value != NULL) {
+            json_buf_append(&json, slot->value, strlen(slot->value));
+        } else {
+            json_buf_append(&json, "null", 4);
+        }
+    }
+
+    json_buf_append(&json, "]", 1);
+
+    return json_buf_detach(&json);
+}
+
+void
+multi_get_callback(int err, char *value, void *extra) {
+    multi_get_slot_t *slot = (multi_get_slot_t *) extra;
+    multi_get_t *batch = slot->batch;
+
+    slot->err = err;
+    slot->value = value;
+
+    if (__sync_sub_and_fetch(&batch->remaining, 1) != 0) {
+        return;
+    }
+
+    char *json = multi_get_to_json(batch);
+
+    for (size_t i = 0; i < batch->count; i++) {
+        free(batch->slots[i].value);
+    }
+
+    batch->cb(json ? 0 : ENOMEM, json, batch->extra);
+
+    free(batch->slots);
+    free(batch);
+}
+
+/**
+ * Coalescing window
+ *
+ * With "coalesce_window_us" set, single gets arriving within the window for
+ * the same table are parked in an open batch and sent back-to-back by the
+ * coalescer thread once the window closes. Callers are never blocked; each
+ * one still receives its own value.
+ */
+typedef struct coalesced_get_t_ {
+    hb_get_t get;
+    get_request_t *request;
+    size_t slot;
+    struct coalesced_get_t_ *next;
+} coalesced_get_t;
+
+typedef struct get_batch_t_ {
+    char *table;
+    struct timespec deadline;
+    coalesced_get_t *head;
+    coalesced_get_t *tail;
+    struct get_batch_t_ *next;
+} get_batch_t;
+
+get_batch_t *open_batches = NULL;
+pthread_t coalescer_thread;
+pthread_cond_t coalescer_cv = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t coalescer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void
+send_get_batch(get_batch_t *batch) {
+    coalesced_get_t *entry = batch->head;
+
+    while (entry) {
+        coalesced_get_t *next = entry->next;
+        pooled_client_t *pooled = acquire_client(entry->slot);
+
+        stats_record_since(STATS_COALESCE, entry->request->start);
+        send_get(entry->request, &entry->request->rpc[0], pooled, entry->get);
+        free(entry);
+
+        entry = next;
+    }
+
+    free(batch->table);
+    free(batch);
+}
+
+void *
+coalescer_run(void *arg) {
+    pthread_mutex_lock(&coalescer_mutex);
+
+    for (;;) {
+        while (open_batches == NULL) {
+            pthread_cond_wait(&coalescer_cv, &coalescer_mutex);
+        }
+
+        // batches are opened in deadline order, so the head closes first
+        get_batch_t *batch = open_batches;
+
+        if (pthread_cond_timedwait(&coalescer_cv, &coalescer_mutex,
+                                   &batch->deadline) != ETIMEDOUT) {
+            continue;
+        }
+
+        open_batches = batch->next;
+
+        pthread_mutex_unlock(&coalescer_mutex);
+        send_get_batch(batch);
+        pthread_mutex_lock(&coalescer_mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * Parks 'get' in the open batch of its table, opening one if needed.
+ *
+ * @returns 0 on success, ENOMEM if the get could not be parked
+ */
+int
+coalesce_get(const char *table_name, hb_get_t get, size_t slot, get_request_t *request) {
+    coalesced_get_t *entry = malloc(sizeof(coalesced_get_t));
+
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+
+    entry->get = get;
+    entry->request = request;
+    entry->slot = slot;
+    entry->next = NULL;
+
+    pthread_mutex_lock(&coalescer_mutex);
+
+    get_batch_t **link = &open_batches;
+
+    while (*link != NULL && strcmp((*link)->table, table_name) != 0) {
+        link = &(*link)->next;
+    }
+
+    get_batch_t *batch = *link;
+
+    if (batch == NULL) {
+        batch = calloc(1, sizeof(get_batch_t));
+
+        if (batch != NULL && (batch->table = strdup(table_name)) == NULL) {
+            free(batch);
+            batch = NULL;
+        }
+
+        if (batch == NULL) {
+            pthread_mutex_unlock(&coalescer_mutex);
+            free(entry);
+
+            return ENOMEM;
+        }
+
+        clock_gettime(CLOCK_REALTIME, &batch->deadline);
+        batch->deadline.tv_nsec += (coalesce_window_us % 1000000) * 1000;
+        batch->deadline.tv_sec += coalesce_window_us / 1000000 + batch->deadline.tv_nsec / 1000000000;
+        batch->deadline.tv_nsec %= 1000000000;
+
+        *link = batch;
+
+        pthread_cond_signal(&coalescer_cv);
+    }
+
+    if (batch->tail) {
+        batch->tail->next = entry;
+    } else {
+        batch->head = entry;
+    }
+
+    batch->tail = entry;
+
+    pthread_mutex_unlock(&coalescer_mutex);
+
+    return 0;
+}
+
+/**
+ * Buffered writes
+ *
+ * "table@rowkey@cf:qual" names the column written by set_value_async() and
+ * incremented by incr_value_async(). Both send bufferable mutations, which
+ * the client holds until they are flushed, and add them to the write batch
+ * open on that client. The batch is committed with hb_client_flush() once it holds
+ * 'write_batch_mutations' mutations or 'write_batch_bytes' bytes, or once it
+ * is 'write_batch_ms' old. Each caller is acknowledged, in submission order,
+ * once its own mutation callback and its batch's flush callback have fired.
+ */
+#define DIRECT_BUFFER_MIN_BYTES 4096
+
+typedef struct write_request_t_ {
+    struct write_batch_t_ *batch;
+    hedis_value_cb cb;
+    void *extra;
+    hb_mutation_t mutation;
+    bool increment;
+    int err;
+    uint64_t start;
+    char *value;                /* new value of an increment */
+    const char *table;          /* points into 'data' */
+    const char *rowkey;         /* points into 'data' */
+    size_t rowkey_len;
+    struct write_request_t_ *next;
+    char data[];
+} write_request_t;
+
+typedef struct write_batch_t_ {
+    pooled_client_t *pooled;
+    size_t mutations;
+    size_t bytes;
+    size_t sending;             /* requests not yet handed to hb_mutation_send() */
+    size_t remaining;           /* callbacks to come, the flush included */
+    bool closed;
+    int flush_err;
+    struct timespec deadline;
+    write_request_t *head;
+    write_request_t *tail;
+    struct write_batch_t_ *next;
+} write_batch_t;
+
+pthread_t write_flusher_thread;
+pthread_cond_t write_cv = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
+write_batch_t *open_write_batches = NULL;
+
+void
+complete_write_batch(write_batch_t *batch) {
+    write_request_t *request = batch->head;
+
+    while (request) {
+        write_request_t *next = request->next;
+        int err = request->err ? request->err : batch->flush_err;
+
+        // a failed write may still have reached the region server
+        miss_filter_invalidate_row(request->table, request->rowkey, request->rowkey_len);
+        row_cache_invalidate_row(request->table, request->rowkey, request->rowkey_len);
+
+        if (err != 0) {
+            free(request->value);
+            request->value = NULL;
+
+            stats_error(err);
+        }
+
+        stats_record_since(STATS_WRITE, request->start);
+
+        request->cb(err, request->value, request->extra);
+
+        hb_mutation_destroy(request->mutation);
+        free(request);
+
+        request = next;
+    }
+
+    free(batch);
+}
+
+void
+release_write_batch(write_batch_t *batch) {
+    if (__sync_sub_and_fetch(&batch->remaining, 1) == 0) {
+        complete_write_batch(batch);
+    }
+}
+
+void
+write_mutation_callback(int32_t err, hb_client_t client,
+                        hb_mutation_t mutation, hb_result_t result, void *extra) {
+    write_request_t *request = (write_request_t *) extra;
+
+    stats_add(STATS_RPCS_IN_FLIGHT, -1);
+
+    if (err != 0) {
+        HBASE_LOG_ERROR("Mutation failed with error code: %d.", err);
+    }
+
+    request->err = err;
+
+    if (err == 0 && request->increment && result != NULL) {
+        const hb_cell_t **cells = NULL;
+        size_t cell_count = 0;
+
+        hb_result_get_cells(result, &cells, &cell_count);
+
+        if (cell_count > 0 && cells[0]->value_len == 8) {
+            uint64_t value = 0;
+
+            for (int i = 0; i < 8; i++) {
+                value = (value << 8) | cells[0]->value[i];
+            }
+
+            request->value = malloc(24);
+
+            // the increment is applied, but its new value cannot be returned
+            if (request->value == NULL) {
+                request->err = ENOMEM;
+            } else {
+                snprintf(request->value, 24, "%lld", (long long) value);
+            }
+        }
+    }
+
+    if (result) {
+        hb_result_destroy(result);
+    }
+
+    release_write_batch(request->batch);
+}
+
+void
+write_flush_callback(int32_t err, hb_client_t client, void *extra) {
+    write_batch_t *batch = (write_batch_t *) extra;
+
+    if (err != 0) {
+        HBASE_LOG_ERROR("Flush failed with error code: %d.", err);
+    }
+
+    release_client(batch->pooled);
+    batch->flush_err = err;
+
+    release_write_batch(batch);
+}
+
+void
+flush_write_batch(write_batch_t *batch) {
+    hb_client_t client = acquire_client(batch->pooled - client_pool)->client;
+    int32_t retCode = hb_client_flush(client, write_flush_callback, batch);
+
+    if (retCode != 0) {
+        write_flush_callback(retCode, client, batch);
+    }
+}
+
+/**
+ * Closes a batch to new writes. Called with 'write_mutex' held.
+ *
+ * @returns true if the caller must flush it, that is if every request of
+ * the batch has already been handed to the client.
+ */
+bool
+close_write_batch(write_batch_t *batch) {
+    if (batch->pooled->open_write_batch == batch) {
+        write_batch_t **link = &open_write_batches;
+
+        while (*link != batch) {
+            link = &(*link)->next;
+        }
+
+        *link = batch->next;
+        batch->pooled->open_write_batch = NULL;
+    }
+
+    batch->closed = true;
+
+    return batch->sending == 0;
+}
+
+void *
+write_flusher_run(void *arg) {
+    pthread_mutex_lock(&write_mutex);
+
+    for (;;) {
+        while (open_write_batches == NULL) {
+            pthread_cond_wait(&write_cv, &write_mutex);
+        }
+
+        // batches are opened in deadline order, so the head closes first
+        write_batch_t *batch = open_write_batches;
+
+        if (pthread_cond_timedwait(&write_cv, &write_mutex,
+                                   &batch->deadline) != ETIMEDOUT
+            || open_write_batches != batch) {
+            continue;
+        }
+
+        bool flush = close_write_batch(batch);
+
+        pthread_mutex_unlock(&write_mutex);
+
+        if (flush) {
+            flush_write_batch(batch);
+        }
+
+        pthread_mutex_lock(&write_mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * Adds a mutation to the open write batch and sends it. 'cb' is invoked
+ * exactly once, when the batch has been committed, unless ENOMEM is
+ * returned, in which case the mutation has been destroyed.
+ */
+int
+submit_write(const command_plan_t *plan, const hedis_command_t *command,
+             hb_mutation_t mutation, bool increment, size_t bytes,
+             hedis_value_cb cb, void *extra) {
+    write_request_t *request = malloc(sizeof(write_request_t)
+                                      + plan->table_len + 1 + command->rowkey_len);
+
+    if (request == NULL) {
+        hb_mutation_destroy(mutation);
+
+        return ENOMEM;
+    }
+
+    request->cb = cb;
+    request->extra = extra;
+    request->mutation = mutation;
+    request->increment = increment;
+    request->err = 0;
+    request->start = stats_now();
+    request->value = NULL;
+    request->next = NULL;
+    memcpy(request->data, plan->table, plan->table_len + 1);
+    memcpy(request->data + plan->table_len + 1, command->rowkey, command->rowkey_len);
+    request->table = request->data;
+    request->rowkey = request->data + plan->table_len + 1;
+    request->rowkey_len = command->rowkey_len;
+
+    // lookups sent from now on must not record the row as missing; it is
+    // invalidated again once the write is committed
+    miss_filter_invalidate_row(request->table, request->rowkey, request->rowkey_len);
+
+    size_t slot = client_slot(command->rowkey, command->rowkey_len);
+
+    pthread_mutex_lock(&write_mutex);
+
+    pooled_client_t *pooled = slot != CLIENT_ANY ? &client_pool[slot]
+                              : open_write_batches ? open_write_batches->pooled
+                              : least_loaded_client();
+    write_batch_t *batch = pooled->open_write_batch;
+
+    if (batch == NULL) {
+        batch = calloc(1, sizeof(write_batch_t));
+
+        if (batch == NULL) {
+            pthread_mutex_unlock(&write_mutex);
+
+            hb_mutation_destroy(mutation);
+            free(request);
+
+            return ENOMEM;
+        }
+
+        batch->pooled = pooled;
+        batch->remaining = 1;
+
+        clock_gettime(CLOCK_REALTIME, &batch->deadline);
+        batch->deadline.tv_nsec += (write_batch_ms % 1000) * 1000000;
+        batch->deadline.tv_sec += write_batch_ms / 1000 + batch->deadline.tv_nsec / 1000000000;
+        batch->deadline.tv_nsec %= 1000000000;
+
+        write_batch_t **link = &open_write_batches;
+
+        while (*link != NULL) {
+            link = &(*link)->next;
+        }
+
+        *link = batch;
+        pooled->open_write_batch = batch;
+
+        pthread_cond_signal(&write_cv);
+    }
+
+    if (batch->tail) {
+        batch->tail->next = request;
+    } else {
+        batch->head = request;
+    }
+
+    batch->tail = request;
+    batch->mutations++;
+    batch->bytes += bytes;
+    batch->sending++;
+    __sync_add_and_fetch(&batch->remaining, 1);
+    request->batch = batch;
+
+    if (batch->mutations >= write_batch_mutations
+        || batch->bytes >= write_batch_bytes || write_batch_ms <= 0) {
+        close_write_batch(batch);
+    }
+
+    pthread_mutex_unlock(&write_mutex);
+
+    stats_add(STATS_WRITES, 1);
+    stats_add(STATS_RPCS_IN_FLIGHT, 1);
+
+    int32_t retCode = hb_mutation_send(pooled->client, mutation, write_mutation_callback, request);
+
+    if (retCode != 0) {
+        HBASE_LOG_ERROR("Could not send mutation : errorCode = %d.", retCode);
+
+        write_mutation_callback(retCode, pooled->client, mutation, NULL, request);
+    }
+
+    pthread_mutex_lock(&write_mutex);
+
+    bool flush = --batch->sending == 0 && batch->closed;
+
+    pthread_mutex_unlock(&write_mutex);
+
+    if (flush) {
+        flush_write_batch(batch);
+    }
+
+    return 0;
+}
+
+/**
+ * Parses a write command, which must name a single row and a column.
+ */
+const command_plan_t *
+acquire_write_plan(const char *str, hedis_command_t *command) {
+    if (hedis_command_parse(str, command) != 0
+        || command->scan != HEDIS_SCAN_NONE
+        || command->qualifier == NULL
+        || memchr(command->rowkey, HEDIS_ROWKEY_SEPARATOR, command->rowkey_len) != NULL) {
+        return NULL;
+    }
+
+    return command_plan_acquire(command);
+}
+
+int
+ensureTable(hb_connection_t connection, const char *table_name) {
+    int32_t retCode = 0;
+    hb_admin_t admin = NULL;
+
+    if ((retCode = hb_admin_create(connection, &admin)) != 0) {
+        HBASE_LOG_ERROR("Could not create HBase admin : errorCode = %d.", retCode);
+
+        goto cleanup;
+    }
+
+    if ((retCode = hb_admin_table_exists(admin, NULL, table_name)) == 0) {
+        HBASE_LOG_INFO("Table '%s' exists", table_name);
+    } else if (retCode != ENOENT) {
+        HBASE_LOG_ERROR("Error while checking if the table exists: errorCode = %d.", retCode);
+    }
+
+cleanup:
+    if (admin) {
+        hb_admin_destroy(admin, NULL, NULL);
+    }
+
+    return retCode;
+}
+
+/**
+ * Warmup
+ *
+ * With "warmup_tables" set, init() has every client of the pool locate the
+ * listed tables, so that the first lookups do not wait for ZooKeeper and
+ * META. It waits at most 'warmup_timeout_ms' for them. A table which could
+ * not be located in time is logged and left to its first request.
+ */
+typedef struct warmup_t_ {
+    pthread_mutex_t mutex;
+    pthread_cond_t cv;
+    size_t remaining;
+} warmup_t;
+
+/* prefetches still running after the timeout complete into it later */
+warmup_t warmup = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0 };
+
+void
+warmup_callback(int32_t err, hb_client_t client, void *extra) {
+    const char *table = (const char *) extra;
+
+    if (err != 0) {
+        HBASE_LOG_ERROR("Could not locate table '%s' : errorCode = %d.", table, err);
+    }
+
+    pthread_mutex_lock(&warmup.mutex);
+    if (--warmup.remaining == 0) {
+        pthread_cond_signal(&warmup.cv);
+    }
+    pthread_mutex_unlock(&warmup.mutex);
+}
+
+void
+warm_up() {
+    uint64_t start = stats_now();
+    size_t tables = 0;
+    char *saveptr = NULL;
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (warmup_timeout_ms % 1000) * 1000000;
+    deadline.tv_sec += warmup_timeout_ms / 1000 + deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+
+    // the names stay in 'warmup_tables', which the callbacks may outlive us to use
+    for (char *table = strtok_r(warmup_tables, ",", &saveptr); table != NULL;
+         table = strtok_r(NULL, ",", &saveptr)) {
+        tables++;
+
+        for (size_t i = 0; i < client_pool_size; i++) {
+            pthread_mutex_lock(&warmup.mutex);
+            warmup.remaining++;
+            pthread_mutex_unlock(&warmup.mutex);
+
+            int32_t retCode = hb_client_prefetch_regions(client_pool[i].client, table,
+                                                         warmup_callback, table);
+
+            if (retCode != 0) {
+                warmup_callback(retCode, client_pool[i].client, table);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&warmup.mutex);
+
+    while (warmup.remaining > 0) {
+        if (pthread_cond_timedwait(&warmup.cv, &warmup.mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    size_t pending = warmup.remaining;
+
+    pthread_mutex_unlock(&warmup.mutex);
+
+    if (pending > 0) {
+        HBASE_LOG_WARN("Warmup timed out with %zu region lookups pending.", pending);
+    }
+
+    HBASE_LOG_INFO("Warmed up %zu tables on %zu clients in %.1f ms.",
+                   tables, client_pool_size, (stats_now() - start) / 1e6);
+}
+
+HBaseLogLevel
+parse_log_level(const char *name) {
+    static const char *names[] = { "fatal", "error", "warn", "info", "debug", "trace" };
+    static const HBaseLogLevel levels[] = {
+        HBASE_LOG_LEVEL_FATAL, HBASE_LOG_LEVEL_ERROR, HBASE_LOG_LEVEL_WARN,
+        HBASE_LOG_LEVEL_INFO, HBASE_LOG_LEVEL_DEBUG, HBASE_LOG_LEVEL_TRACE
+    };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (!strcasecmp(name, names[i])) {
+            return levels[i];
+        }
+    }
+
+    return HBASE_LOG_LEVEL_INVALID;
+}
+
+int init(hedisConfigEntry **entries, int entry_count) {
+    bool client_dispatch_valid = true;
+
+    hedis_entries = entries;
+    hedis_entry_count = entry_count;
+
+    for (int i = 0; i < hedis_entry_count; i++) {
+        if (!strcasecmp(hedis_entries[i]->key, "zookeeper")) {
+            connector_zookeeper = malloc(sizeof(char) * (strlen(hedis_entries[i]->value) + 1));
+
+            strcpy(connector_zookeeper, hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "coalesce_window_us")) {
+            coalesce_window_us = atol(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "cache_ttl_ms")) {
+            cache_ttl_ms = atol(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "cache_max_entries")) {
+            cache_max_entries = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "cache_max_bytes")) {
+            cache_max_bytes = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "cache_shards")) {
+            cache_shards = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "scan_batch_rows")) {
+            scan_batch_rows = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "scan_prefetch")) {
+            scan_prefetch = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "scan_max_rows")) {
+            scan_max_rows = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "write_batch_mutations")) {
+            write_batch_mutations = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "write_batch_bytes")) {
+            write_batch_bytes = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "write_batch_ms")) {
+            write_batch_ms = atol(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "log_level")) {
+            log_level = parse_log_level(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "client_pool_size")) {
+            client_pool_size = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "client_pool_connections")) {
+            client_pool_connections = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "client_dispatch")) {
+            client_dispatch_hash = !strcasecmp(hedis_entries[i]->value, "hash");
+            client_dispatch_valid = client_dispatch_hash
+                                    || !strcasecmp(hedis_entries[i]->value, "least_loaded");
+        } else if (!strcasecmp(hedis_entries[i]->key, "client_max_in_flight")) {
+            client_max_in_flight = atol(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "classpath_cache")) {
+            // read by libhbase when it starts the JVM
+            setenv("LIBHBASE_CLASSPATH_CACHE", hedis_entries[i]->value, 1);
+        } else if (!strcasecmp(hedis_entries[i]->key, "warmup_tables")) {
+            free(warmup_tables);
+            warmup_tables = strdup(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "warmup_timeout_ms")) {
+            warmup_timeout_ms = atol(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "miss_filter_bytes")) {
+            miss_filter_bytes = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "miss_exact_entries")) {
+            miss_exact_entries = strtoul(hedis_entries[i]->value, NULL, 10);
+        } else if (!strcasecmp(hedis_entries[i]->key, "miss_ttl_ms")) {
+            miss_ttl_ms = atol(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "request_timeout_ms")) {
+            request_timeout_ms = atol(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "hedge_percentile")) {
+            hedge_percentile = atof(hedis_entries[i]->value);
+        } else if (!strcasecmp(hedis_entries[i]->key, "hedge_min_delay_us")) {
+            hedge_min_delay_us = atol(hedis_entries[i]->value);
+        }
+    }
+
+    if (log_level == HBASE_LOG_LEVEL_INVALID) {
+        printf("Invalid log level\n");
+
+        return -1;
+    }
+
+    if (client_pool_size == 0 || client_pool_connections == 0
+        || client_pool_connections > client_pool_size || !client_dispatch_valid) {
+        printf("Invalid client pool settings\n");
+
+        return -1;
+    }
+
+    if (hedge_percentile < 0 || hedge_percentile >= 100 || hedge_min_delay_us < 0) {
+        printf("Invalid hedge settings\n");
+
+        return -1;
+    }
+
+    if (scan_batch_rows == 0 || scan_prefetch == 0) {
+        printf("Invalid scan settings\n");
+
+        return -1;
+    }
+
+    if (row_cache_init(cache_shards, cache_max_entries, cache_max_bytes, cache_ttl_ms) != 0) {
+        printf("Invalid row cache settings\n");
+
+        return -1;
+    }
+
+    if (miss_filter_init(miss_filter_bytes, miss_exact_entries, miss_ttl_ms) != 0) {
+        printf("Invalid miss filter settings\n");
+
+        return -1;
+    }
+
+    // the log stream is shared by every lookup, so it is set up only once
+    hb_log_set_level(log_level);
+    const char *logFilePath = getenv("HBASE_LOG_FILE");
+    if (logFilePath != NULL) {
+        logFile = fopen(logFilePath, "a");
+        if (!logFile) {
+            fprintf(stderr, "Unable to open log file \"%s\"", logFilePath);
+            perror(NULL);
+
+            return -1;
+        }
+        hb_log_set_stream(logFile); // defaults to stderr
+    }
+
+    HBASE_LOG_INFO("Connecting to HBase cluster using Zookeeper ensemble '%s' "
+                   "with %zu clients over %zu connections.",
+                   connector_zookeeper, client_pool_size, client_pool_connections);
+
+    if (create_client_pool() != 0) {
+        return -1;
+    }
+
+    if (warmup_tables != NULL) {
+        warm_up();
+    }
+
+    if (coalesce_window_us > 0
+        && pthread_create(&coalescer_thread, NULL, coalescer_run, NULL) != 0) {
+        HBASE_LOG_ERROR("Could not start get coalescer thread.");
+
+        return -1;
+    }
+
+    if (write_batch_ms > 0
+        && pthread_create(&write_flusher_thread, NULL, write_flusher_run, NULL) != 0) {
+        HBASE_LOG_ERROR("Could not start write flusher thread.");
+
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Serves a row lookup from the row cache, or sends a get for it (through the
+ * coalescer if asked to). 'deadline' is a stats_now() timestamp, or 0 for
+ * none. 'cb' is invoked exactly once, possibly before this returns, unless a
+ * non-zero error code is returned.
+ */
+int
+request_row(const command_plan_t *plan, const char *rowkey, size_t rowkey_len,
+            bool coalesce, uint64_t deadline, hedis_value_cb cb, void *extra) {
+    char *cache_key = NULL;
+    size_t cache_key_len = 0;
+    uint32_t cache_version = 0;
+    miss_key_t miss_key;
+    uint32_t miss_version = 0;
+
+    stats_add(STATS_GETS, 1);
+
+    if (miss_filter_enabled()) {
+        miss_filter_key(plan->table, rowkey, rowkey_len, plan->family, plan->qualifier, &miss_key);
+
+        if (miss_filter_contains(&miss_key)) {
+            stats_add(STATS_MISS_HITS, 1);
+            cb(0, NULL, extra);
+
+            return 0;
+        }
+
+        // taken before the get is sent, so that a write racing it wins
+        miss_version = miss_filter_version(&miss_key);
+    }
+
+    // a key which cannot be allocated leaves the lookup to HBase
+    if (row_cache_enabled()
+        && (cache_key = row_cache_key(plan->table, rowkey, rowkey_len, plan->family,
+                                      plan->qualifier, &cache_key_len)) != NULL) {
+        // taken before the get is sent, so that a write racing it wins
+        cache_version = row_cache_version(cache_key, cache_key_len);
+
+        char *value = row_cache_get(cache_key, cache_key_len);
+
+        if (value != NULL) {
+            free(cache_key);
+
+            stats_add(STATS_BYTES_RETURNED, strlen(value));
+            cb(0, value, extra);
+
+            return 0;
+        }
+    }
+
+    hb_get_t get = create_get(plan, rowkey, rowkey_len);
+
+    if (get == NULL) {
+        free(cache_key);
+
+        return EINVAL;
+    }
+
+    get_request_t *request = rowkey_len <= GET_REQUEST_POOLED_ROWKEY
+                             ? object_pool_get(&get_request_pool)
+                             : malloc(sizeof(get_request_t) + rowkey_len);
+
+    if (request == NULL) {
+        hb_get_destroy(get);
+        free(cache_key);
+
+        return ENOMEM;
+    }
+
+    request->cb = cb;
+    request->extra = extra;
+    request->cache_key = cache_key;
+    request->cache_key_len = cache_key_len;
+    request->cache_version = cache_version;
+    request->start = stats_now();
+    request->refs = 2;
+    request->rpcs = 1;
+    request->done = 0;
+    request->rpc[0].pooled = NULL;
+    request->rpc[1].pooled = NULL;
+    request->plan = NULL;
+    request->miss_key = miss_key;
+    request->miss_version = miss_version;
+    request->rowkey_len = rowkey_len;
+    memcpy(request->rowkey, rowkey, rowkey_len);
+    timer_init(&request->deadline);
+    timer_init(&request->hedge);
+    request->deadline_armed = false;
+    request->hedge_armed = false;
+
+    // a timer holds a reference from before it is armed, as it may run at once
+    if (deadline != 0) {
+        __sync_add_and_fetch(&request->refs, 1);
+        __atomic_store_n(&request->deadline_armed, true, __ATOMIC_RELEASE);
+
+        if (timer_add(&request->deadline, deadline, get_deadline_callback) != 0) {
+            __sync_sub_and_fetch(&request->refs, 1);
+        }
+    }
+
+    uint64_t hedge_at = hedge_percentile > 0 ? hedge_delay() : 0;
+
+    if (hedge_at != 0) {
+        hedge_at += request->start;
+    }
+
+    if (hedge_at != 0 && (deadline == 0 || hedge_at < deadline)
+        && (request->plan = command_plan_retain(plan)) != NULL) {
+        __sync_add_and_fetch(&request->refs, 1);
+        __atomic_store_n(&request->hedge_armed, true, __ATOMIC_RELEASE);
+
+        if (timer_add(&request->hedge, hedge_at, get_hedge_callback) != 0) {
+            __sync_sub_and_fetch(&request->refs, 1);
+        }
+    }
+
+    size_t slot = client_slot(rowkey, rowkey_len);
+
+    if (coalesce) {
+        int err = coalesce_get(plan->table, get, slot, request);
+
+        if (err != 0) {
+            fail_get(request, get, err);
+        }
+    } else {
+        send_get(request, &request->rpc[0], acquire_client(slot), get);
+    }
+
+    release_get_request(request);
+
+    return 0;
+}
+
+int
+send_multi_get(const command_plan_t *plan, const char *rowkeys, size_t rowkeys_len,
+               uint64_t deadline, hedis_value_cb cb, void *extra) {
+    const char *rowkeys_end = rowkeys + rowkeys_len;
+    size_t count = 1;
+
+    for (const char *p = rowkeys; p < rowkeys_end; p++) {
+        if (*p == HEDIS_ROWKEY_SEPARATOR
+            && (p == rowkeys || p + 1 == rowkeys_end || p[1] == HEDIS_ROWKEY_SEPARATOR)) {
+            return EINVAL;
+        }
+
+        if (*p == HEDIS_ROWKEY_SEPARATOR) {
+            count++;
+        }
+    }
+
+    multi_get_t *batch = malloc(sizeof(multi_get_t));
+
+    if (batch == NULL) {
+        return ENOMEM;
+    }
+
+    batch->cb = cb;
+    batch->extra = extra;
+    batch->count = count;
+    batch->remaining = count;
+    batch->slots = calloc(count, sizeof(multi_get_slot_t));
+
+    if (batch->slots == NULL) {
+        free(batch);
+
+        return ENOMEM;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        batch->slots[i].batch = batch;
+    }
+
+    // the last completion frees the batch, so only the rowkey list is
+    // walked from here on
+    const char *rowkey = rowkeys;
+
+    for (size_t i = 0; i < count; i++) {
+        const char *end = memchr(rowkey, HEDIS_ROWKEY_SEPARATOR, rowkeys_end - rowkey);
+        size_t rowkey_len = end ? (size_t)(end - rowkey) : (size_t)(rowkeys_end - rowkey);
+        multi_get_slot_t *slot = &batch->slots[i];
+
+        int32_t retCode = request_row(plan, rowkey, rowkey_len, false, deadline,
+                                      multi_get_callback, slot);
+
+        if (retCode != 0) {
+            multi_get_callback(retCode, NULL, slot);
+        }
+
+        if (end != NULL) {
+            rowkey = end + 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Range scans
+ *
+ * "table@start~end[@cf[:qual]]" scans from 'start' (inclusive) to 'end'
+ * (exclusive), either of which may be left out, and "table@prefix*[@cf[:qual]]"
+ * scans the rows starting with 'prefix'.
+ *
+ * Rows are streamed as one JSON array per hb_scanner_next() batch. The next
+ * batch is requested as soon as one arrives, so it is on the wire while the
+ * current one is serialized, but at most 'scan_prefetch' batches are ever
+ * held undelivered. Memory stays bounded by the read-ahead whatever the size
+ * of the range.
+ */
+typedef struct scan_batch_t_ {
+    hb_result_t *results;
+    size_t count;
+    struct scan_batch_t_ *next;
+} scan_batch_t;
+
+typedef struct scan_stream_t_ {
+    pthread_mutex_t mutex;
+    pooled_client_t *pooled;
+    hb_scanner_t scanner;
+    hedis_scan_cb cb;
+    void *extra;
+    size_t max_rows;            /* 0 for no limit */
+    size_t rows;                /* rows received so far */
+    scan_batch_t *head;
+    scan_batch_t *tail;
+    size_t queued;              /* batches received but not delivered */
+    int active;                 /* threads inside scan_pump() */
+    bool fetching;
+    uint64_t fetch_start;
+    bool delivering;
+    bool exhausted;
+    bool finished;
+    int err;
+} scan_stream_t;
+
+void scan_next_callback(int32_t err, hb_scanner_t scanner,
+                        hb_result_t results[], size_t num_results, void *extra);
+
+char *scan_batch_to_json(const scan_batch_t *batch) {
+    json_buf_t json;
+    size_t length = 2;
+    size_t written = 0;
+    uint64_t start = stats_now();
+
+    for (size_t i = 0; i < batch->count; i++) {
+        const byte_t *key = NULL;
+        size_t key_len = 0;
+        const hb_cell_t **cells = NULL;
+        size_t cell_count = 0;
+
+        hb_result_get_key(batch->results[i], &key, &key_len);
+        hb_result_get_cells(batch->results[i], &cells, &cell_count);
+
+        length += json_row_size_hint(key_len, cells, cell_count) + 1;
+    }
+
+    if (json_buf_init(&json, length) != 0) {
+        return NULL;
+    }
+
+    json_buf_append(&json, "[", 1);
+
+    for (size_t i = 0; i < batch->count; i++) {
+        const byte_t *key = NULL;
+        size_t key_len = 0;
+        const hb_cell_t **cells = NULL;
+        size_t cell_count = 0;
+
+        hb_result_get_key(batch->results[i], &key, &key_len);
+
+        if (key == NULL) {
+            continue;
+        }
+
+        hb_result_get_cells(batch->results[i], &cells, &cell_count);
+
+        if (written++ != 0) {
+            json_buf_append(&json, ",", 1);
+        }
+
+        json_write_row(&json, key, key_len, cells, cell_count);
+    }
+
+    json_buf_append(&json, "]", 1);
+
+    stats_record_since(STATS_SCAN_JSON, start);
+    stats_add(STATS_BYTES_RETURNED, json.len);
+
+    return json_buf_detach(&json);
+}
+
+void
+destroy_scan_batch(scan_batch_t *batch) {
+    for (size_t i = 0; i < batch->count; i++) {
+        hb_result_destroy(batch->results[i]);
+    }
+
+    free(batch->results);
+    free(batch);
+}
+
+void
+finish_scan(scan_stream_t *stream) {
+    while (stream->head) {
+        scan_batch_t *batch = stream->head;
+
+        stream->head = batch->next;
+        destroy_scan_batch(batch);
+    }
+
+    hb_scanner_destroy(stream->scanner, NULL, NULL);
+
+    stream->cb(stream->err, NULL, 1, stream->extra);
+
+    pthread_mutex_destroy(&stream->mutex);
+    free(stream);
+}
+
+/**
+ * Keeps one hb_scanner_next() in flight while the read-ahead has room and
+ * delivers queued batches in order. Only one thread delivers at a time; a
+ * callback arriving meanwhile queues its batch and leaves. Called with the
+ * stream mutex held, returns with it released.
+ */
+void
+scan_pump(scan_stream_t *stream) {
+    stream->active++;
+
+    for (;;) {
+        if (!stream->fetching && !stream->exhausted && stream->queued < scan_prefetch) {
+            stream->fetching = true;
+            stream->fetch_start = stats_now();
+            stats_add(STATS_RPCS_IN_FLIGHT, 1);
+            hold_client(stream->pooled);
+
+            pthread_mutex_unlock(&stream->mutex);
+            int32_t retCode = hb_scanner_next(stream->scanner, scan_next_callback, stream);
+            pthread_mutex_lock(&stream->mutex);
+
+            if (retCode != 0) {
+                HBASE_LOG_ERROR("Could not fetch next rows : errorCode = %d.", retCode);
+
+                stats_add(STATS_RPCS_IN_FLIGHT, -1);
+                stats_error(retCode);
+                release_client(stream->pooled);
+
+                stream->fetching = false;
+                stream->exhausted = true;
+                stream->err = retCode;
+            }
+
+            continue;
+        }
+
+        if (stream->delivering || stream->head == NULL) {
+            break;
+        }
+
+        scan_batch_t *batch = stream->head;
+
+        stream->head = batch->next;
+        if (stream->head == NULL) {
+            stream->tail = NULL;
+        }
+        stream->queued--;
+        stream->delivering = true;
+
+        pthread_mutex_unlock(&stream->mutex);
+
+        char *chunk = scan_batch_to_json(batch);
+
+        destroy_scan_batch(batch);
+
+        if (chunk != NULL) {
+            stream->cb(0, chunk, 0, stream->extra);
+        }
+
+        pthread_mutex_lock(&stream->mutex);
+
+        stream->delivering = false;
+
+        if (chunk == NULL) {
+            stream->exhausted = true;
+            stream->err = ENOMEM;
+        }
+    }
+
+    bool finish = --stream->active == 0 && !stream->finished
+                  && stream->exhausted && !stream->fetching && stream->head == NULL;
+
+    if (finish) {
+        stream->finished = true;
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    if (finish) {
+        finish_scan(stream);
+    }
+}
+
+void
+scan_next_callback(int32_t err, hb_scanner_t scanner,
+                   hb_result_t results[], size_t num_results, void *extra) {
+    scan_stream_t *stream = (scan_stream_t *) extra;
+    scan_batch_t *batch = NULL;
+
+    if (err != 0) {
+        HBASE_LOG_ERROR("Scan failed with error code: %d.", err);
+
+        stats_error(err);
+    }
+
+    pthread_mutex_lock(&stream->mutex);
+
+    stats_record_since(STATS_SCAN_BATCH, stream->fetch_start);
+    stats_add(STATS_RPCS_IN_FLIGHT, -1);
+    release_client(stream->pooled);
+    stream->fetching = false;
+
+    if (err == 0 && num_results > 0 && !stream->exhausted) {
+        if (stream->max_rows && stream->rows + num_results > stream->max_rows) {
+            // the range holds more rows than the caller accepts; rather
+            // than passing a truncated result off as complete, the rows
+            // are dropped below and the scan ends with the error
+            stats_error(EOVERFLOW);
+
+            stream->exhausted = true;
+            stream->err = EOVERFLOW;
+        } else if ((batch = malloc(sizeof(scan_batch_t))) != NULL
+                   && (batch->results = malloc(num_results * sizeof(hb_result_t))) == NULL) {
+            free(batch);
+            batch = NULL;
+        }
+
+        if (batch != NULL) {
+            batch->count = num_results;
+            batch->next = NULL;
+
+            // libhbase frees the array itself once this returns
+            memcpy(batch->results, results, num_results * sizeof(hb_result_t));
+
+            stream->rows += num_results;
+        } else if (stream->err == 0) {
+            // the rows are dropped below and the scan ends with the error
+            stats_error(ENOMEM);
+
+            stream->exhausted = true;
+            stream->err = ENOMEM;
+        }
+    } else {
+        stream->exhausted = true;
+
+        if (err != 0) {
+            stream->err = err;
+        }
+    }
+
+    for (size_t i = batch ? batch->count : 0; i < num_results; i++) {
+        hb_result_destroy(results[i]);
+    }
+
+    if (batch != NULL) {
+        if (stream->tail) {
+            stream->tail->next = batch;
+        } else {
+            stream->head = batch;
+        }
+
+        stream->tail = batch;
+        stream->queued++;
+    }
+
+    scan_pump(stream);
+}
+
+int
+start_scan(const command_plan_t *plan, const hedis_command_t *command,
+           size_t max_rows, hedis_scan_cb cb, void *extra) {
+    int32_t retCode = 0;
+    hb_scanner_t scanner = NULL;
+    pooled_client_t *pooled = acquire_client(client_slot(command->rowkey, command->rowkey_len));
+
+    if ((retCode = hb_scanner_create(pooled->client, &scanner)) != 0) {
+        HBASE_LOG_ERROR("Could not create scanner : errorCode = %d.", retCode);
+
+        release_client(pooled);
+
+        return retCode;
+    }
+
+    hb_scanner_set_table(scanner, plan->table, plan->table_len);
+
+    if (command->rowkey_len > 0) {
+        hb_scanner_set_start_row(scanner, (const byte_t *)command->rowkey, command->rowkey_len);
+    }
+
+    if (command->scan == HEDIS_SCAN_RANGE && command->end_row_len > 0) {
+        hb_scanner_set_end_row(scanner, (const byte_t *)command->end_row, command->end_row_len);
+    } else if (command->scan == HEDIS_SCAN_PREFIX && command->rowkey_len > 0) {
+        // the first rowkey past the prefix, unless the prefix is all 0xff
+        byte_t end_row[command->rowkey_len];
+        size_t end_row_len = command->rowkey_len;
+
+        memcpy(end_row, command->rowkey, end_row_len);
+
+        while (end_row_len > 0 && end_row[end_row_len - 1] == 0xff) {
+            end_row_len--;
+        }
+
+        if (end_row_len > 0) {
+            end_row[end_row_len - 1]++;
+            hb_scanner_set_end_row(scanner, end_row, end_row_len);
+        }
+    }
+
+    if (plan->family != NULL) {
+        hb_scanner_set_column(scanner, (const byte_t *)plan->family, plan->family_len,
+                              (const byte_t *)plan->qualifier, plan->qualifier_len);
+    }
+
+    hb_scanner_set_num_versions(scanner, 10);
+    hb_scanner_set_num_max_rows(scanner, scan_batch_rows);
+
+    scan_stream_t *stream = calloc(1, sizeof(scan_stream_t));
+
+    if (stream == NULL) {
+        release_client(pooled);
+        hb_scanner_destroy(scanner, NULL, NULL);
+
+        return ENOMEM;
+    }
+
+    pthread_mutex_init(&stream->mutex, NULL);
+    stream->pooled = pooled;
+    stream->scanner = scanner;
+    stream->cb = cb;
+    stream->extra = extra;
+    stream->max_rows = max_rows;
+    stream->fetching = true;
+    stream->fetch_start = stats_now();
+
+    stats_add(STATS_SCANS, 1);
+    stats_add(STATS_RPCS_IN_FLIGHT, 1);
+
+    // the first fetch is sent here so that a failure can still be returned
+    if ((retCode = hb_scanner_next(scanner, scan_next_callback, stream)) != 0) {
+        HBASE_LOG_ERROR("Could not start scan : errorCode = %d.", retCode);
+
+        stats_add(STATS_RPCS_IN_FLIGHT, -1);
+        stats_error(retCode);
+        release_client(pooled);
+
+        pthread_mutex_destroy(&stream->mutex);
+        free(stream);
+        hb_scanner_destroy(scanner, NULL, NULL);
+    }
+
+    return retCode;
+}
+
+/**
+ * Collects a whole scan into the single JSON array get_value_async() hands
+ * to its callback. A scan of more than 'scan_max_rows' rows, if set, ends
+ * with EOVERFLOW instead.
+ */
+typedef struct scan_collector_t_ {
+    hedis_value_cb cb;
+    void *extra;
+    json_buf_t json;
+    bool empty;
+} scan_collector_t;
+
+void
+scan_collect_callback(int err, char *chunk, int last, void *extra) {
+    scan_collector_t *collector = (scan_collector_t *) extra;
+
+    if (chunk != NULL) {
+        size_t len = strlen(chunk);
+
+        // splice the rows of the chunk into the outer array
+        if (len > 2) {
+            if (!collector->empty) {
+                json_buf_append(&collector->json, ",", 1);
+            }
+
+            json_buf_append(&collector->json, chunk + 1, len - 2);
+            collector->empty = false;
+        }
+
+        free(chunk);
+    }
+
+    if (!last) {
+        return;
+    }
+
+    json_buf_append(&collector->json, "]", 1);
+
+    char *value = json_buf_detach(&collector->json);
+
+    if (err == 0 && value == NULL) {
+        err = ENOMEM;
+    } else if (err != 0) {
+        free(value);
+        value = NULL;
+    }
+
+    collector->cb(err, value, collector->extra);
+
+    free(collector);
+}
+
+int
+request_scan(const command_plan_t *plan, const hedis_command_t *command,
+             hedis_value_cb cb, void *extra) {
+    scan_collector_t *collector = malloc(sizeof(scan_collector_t));
+
+    if (collector == NULL) {
+        return ENOMEM;
+    }
+
+    if (json_buf_init(&collector->json, 256) != 0) {
+        free(collector);
+
+        return ENOMEM;
+    }
+
+    json_buf_append(&collector->json, "[", 1);
+    collector->cb = cb;
+    collector->extra = extra;
+    collector->empty = true;
+
+    int32_t retCode = start_scan(plan, command, scan_max_rows,
+                                 scan_collect_callback, collector);
+
+    if (retCode != 0) {
+        json_buf_free(&collector->json);
+        free(collector);
+    }
+
+    return retCode;
+}
+
+int scan_value_async(const char *str, hedis_scan_cb cb, void *extra) {
+    hedis_command_t command;
+
+    if (hedis_command_parse(str, &command) != 0 || command.scan == HEDIS_SCAN_NONE) {
+        return EINVAL;
+    }
+
+    const command_plan_t *plan = command_plan_acquire(&command);
+
+    if (plan == NULL) {
+        return ENOMEM;
+    }
+
+    int32_t retCode = start_scan(plan, &command, 0, cb, extra);
+
+    command_plan_release(plan);
+
+    return retCode;
+}
+
+int set_value_async(const char *str, const char *value, size_t value_len,
+                    hedis_value_cb cb, void *extra) {
+    hedis_command_t command;
+    const command_plan_t *plan = acquire_write_plan(str, &command);
+    hb_put_t put = NULL;
+    int32_t retCode = 0;
+
+    if (plan == NULL || value == NULL || value_len == 0) {
+        command_plan_release(plan);
+
+        return EINVAL;
+    }
+
+    if ((retCode = hb_put_create((const byte_t *)command.rowkey, command.rowkey_len, &put)) != 0) {
+        HBASE_LOG_ERROR("Could not create put : errorCode = %d.", retCode);
+
+        command_plan_release(plan);
+
+        return retCode;
+    }
+
+    hb_mutation_set_table(put, plan->table, plan->table_len);
+    hb_mutation_set_bufferable(put, true);
+
+    // large values skip the JNI copy into a Java byte array
+    if (value_len >= DIRECT_BUFFER_MIN_BYTES) {
+        hb_mutation_set_direct_buffers(put, true);
+    }
+
+    if ((retCode = hb_put_add_column(put, (const byte_t *)plan->family, plan->family_len,
+                                     (const byte_t *)plan->qualifier, plan->qualifier_len,
+                                     (const byte_t *)value, value_len)) != 0) {
+        HBASE_LOG_ERROR("Could not add column to put : errorCode = %d.", retCode);
+
+        hb_mutation_destroy(put);
+        command_plan_release(plan);
+
+        return retCode;
+    }
+
+    retCode = submit_write(plan, &command, put, false,
+                           command.rowkey_len + plan->family_len + plan->qualifier_len + value_len,
+                           cb, extra);
+
+    command_plan_release(plan);
+
+    return retCode;
+}
+
+int incr_value_async(const char *str, long long amount, hedis_value_cb cb, void *extra) {
+    hedis_command_t command;
+    const command_plan_t *plan = acquire_write_plan(str, &command);
+    hb_increment_t increment = NULL;
+    int32_t retCode = 0;
+
+    if (plan == NULL) {
+        return EINVAL;
+    }
+
+    if ((retCode = hb_increment_create((const byte_t *)command.rowkey, command.rowkey_len,
+                                       &increment)) != 0) {
+        HBASE_LOG_ERROR("Could not create increment : errorCode = %d.", retCode);
+
+        command_plan_release(plan);
+
+        return retCode;
+    }
+
+    hb_cell_t cell;
+
+    memset(&cell, 0, sizeof(hb_cell_t));
+    cell.family = (byte_t *)plan->family;
+    cell.family_len = plan->family_len;
+    cell.qualifier = (byte_t *)plan->qualifier;
+    cell.qualifier_len = plan->qualifier_len;
+
+    hb_mutation_set_table(increment, plan->table, plan->table_len);
+    hb_mutation_set_bufferable(increment, true);
+
+    if ((retCode = hb_increment_add_column(increment, &cell, amount)) != 0) {
+        HBASE_LOG_ERROR("Could not add column to increment : errorCode = %d.", retCode);
+
+        hb_mutation_destroy(increment);
+        command_plan_release(plan);
+
+        return retCode;
+    }
+
+    retCode = submit_write(plan, &command, increment, true,
+                           command.rowkey_len + plan->family_len + plan->qualifier_len
+                           + sizeof(int64_t),
+                           cb, extra);
+
+    command_plan_release(plan);
+
+    return retCode;
+}
+
+char *get_stats() {
+    stats_snapshot_t *snapshot = malloc(sizeof(stats_snapshot_t));
+    row_cache_stats_t cache;
+    miss_filter_stats_t misses;
+    json_buf_t json;
+
+    if (snapshot == NULL || json_buf_init(&json, 4096) != 0) {
+        free(snapshot);
+
+        return NULL;
+    }
+
+    stats_snapshot(snapshot);
+    row_cache_get_stats(&cache);
+    miss_filter_get_stats(&misses);
+
+    json_buf_append(&json, "{", 1);
+    stats_write_json(&json, snapshot);
+
+    char text[256];
+    int len = snprintf(text, sizeof(text),
+                       ",\"cache\":{\"hits\":%llu,\"misses\":%llu,\"evictions\":%llu,"
+                       "\"expirations\":%llu,\"entries\":%llu,\"bytes\":%llu}",
+                       (unsigned long long) cache.hits, (unsigned long long) cache.misses,
+                       (unsigned long long) cache.evictions, (unsigned long long) cache.expirations,
+                       (unsigned long long) cache.entries, (unsigned long long) cache.bytes);
+
+    json_buf_append(&json, text, len);
+
+    len = snprintf(text, sizeof(text),
+                   ",\"miss_filter\":{\"false_positives\":%llu,\"rotations\":%llu,"
+                   "\"exact_entries\":%llu}",
+                   (unsigned long long) misses.false_positives,
+                   (unsigned long long) misses.rotations,
+                   (unsigned long long) misses.exact_entries);
+
+    json_buf_append(&json, text, len);
+    json_buf_append(&json, ",\"clients\":[", 12);
+
+    for (size_t i = 0; client_pool != NULL && i < client_pool_size; i++) {
+        len = snprintf(text, sizeof(text), "%s%ld", i ? "," : "",
+                       __atomic_load_n(&client_pool[i].in_flight, __ATOMIC_RELAXED));
+
+        json_buf_append(&json, text, len);
+    }
+
+    json_buf_append(&json, "]}", 2);
+
+    free(snapshot);
+
+    return json_buf_detach(&json);
+}
+
+/**
+ * @returns the stats_now() timestamp 'timeout_ms' from now, or 0 for none
+ */
+uint64_t
+deadline_after(long timeout_ms) {
+    return timeout_ms > 0 ? stats_now() + (uint64_t) timeout_ms * 1000000 : 0;
+}
+
+int
+get_value_until(const char *str, uint64_t deadline, hedis_value_cb cb, void *extra) {
+    hedis_command_t command;
+    uint64_t start = stats_now();
+
+    if (strcmp(str, HEDIS_STATS_COMMAND) == 0) {
+        char *stats = get_stats();
+
+        cb(stats ? 0 : ENOMEM, stats, extra);
+
+        return 0;
+    }
+
+    if (hedis_command_parse(str, &command) != 0) {
+        return EINVAL;
+    }
+
+    const command_plan_t *plan = command_plan_acquire(&command);
+
+    if (plan == NULL) {
+        return ENOMEM;
+    }
+
+    stats_record_since(STATS_PARSE, start);
+
+    int32_t retCode = 0;
+
+    if (command.scan != HEDIS_SCAN_NONE) {
+        retCode = request_scan(plan, &command, cb, extra);
+    } else if (memchr(command.rowkey, HEDIS_ROWKEY_SEPARATOR, command.rowkey_len) != NULL) {
+        retCode = send_multi_get(plan, command.rowkey, command.rowkey_len, deadline, cb, extra);
+    } else {
+        retCode = request_row(plan, command.rowkey, command.rowkey_len,
+                              coalesce_window_us > 0, deadline, cb, extra);
+    }
+
+    command_plan_release(plan);
+
+    return retCode;
+}
+
+int get_value_async(const char *str, hedis_value_cb cb, void *extra) {
+    return get_value_until(str, deadline_after(request_timeout_ms), cb, extra);
+}
+
+int get_value_async_timeout(const char *str, long timeout_ms, hedis_value_cb cb, void *extra) {
+    return get_value_until(str, deadline_after(timeout_ms), cb, extra);
+}
+
+char *get_value_timeout(const char *str, long timeout_ms) {
+    uint64_t start = stats_now();
+    uint64_t deadline = deadline_after(timeout_ms);
+    get_context_t *ctx = new_get_context();
+    char *value = NULL;
+
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    if (get_value_until(str, deadline, get_value_callback, ctx) == 0) {
+        wait_for_get(ctx, deadline, &value);
+    } else {
+        release_get_context(ctx);
+    }
+
+    stats_record_since(STATS_GET, start);
+
+    release_get_context(ctx);
+
+    return value;
+}
+
+char *get_value(const char *str) {
+    return get_value_timeout(str, request_timeout_ms);
+}
+
+int set_value(const char *str, const char *value, size_t value_len) {
+    uint64_t deadline = deadline_after(request_timeout_ms);
+    get_context_t *ctx = new_get_context();
+
+    if (ctx == NULL) {
+        return ENOMEM;
+    }
+
+    int err = set_value_async(str, value, value_len, get_value_callback, ctx);
+
+    if (err == 0) {
+        err = wait_for_get(ctx, deadline, NULL);
+    } else {
+        release_get_context(ctx);
+    }
+
+    release_get_context(ctx);
+
+    return err;
+}
+
+char *incr_value(const char *str, long long amount) {
+    uint64_t deadline = deadline_after(request_timeout_ms);
+    get_context_t *ctx = new_get_context();
+    char *value = NULL;
+
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    if (incr_value_async(str, amount, get_value_callback, ctx) == 0) {
+        wait_for_get(ctx, deadline, &value);
+    } else {
+        release_get_context(ctx);
+    }
 
-    HBASE_LOG_INFO("Return value: %s\n", value);
+    release_get_context(ctx);
 
     return value;
 }
@@ -0,0 +1,408 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "miss_filter.h"
+
+#line __LINE__ "miss_filter.c"
+
+#define BLOCK_WORDS 8           /* 512 bits, one cache line */
+#define BLOCK_BITS (BLOCK_WORDS * 64)
+#define BITS_PER_KEY 6          /* 9 bits of the lookup hash each */
+#define GENERATIONS 3
+#define EXACT_WAYS 4
+#define EXACT_LOCKS 64
+#define VERSION_SLOTS 4096
+
+typedef struct exact_entry_t_ {
+    uint64_t row;
+    uint64_t lookup;
+    uint64_t expires_us;        /* 0 for a free way */
+} exact_entry_t;
+
+static int enabled = 0;
+static uint64_t ttl_us = 0;
+
+static uint64_t *generations[GENERATIONS];
+static size_t block_mask = 0;
+static uint64_t epoch = 0;      /* generations[epoch % GENERATIONS] takes new misses */
+static uint64_t rotation_us = 0;
+static uint64_t next_rotation_us = 0;
+
+static exact_entry_t *exact = NULL;
+static size_t exact_mask = 0;
+static pthread_mutex_t exact_locks[EXACT_LOCKS];
+
+static uint32_t versions[VERSION_SLOTS];
+static uint64_t false_positives = 0;
+static uint64_t rotations = 0;
+static uint64_t exact_entries = 0;
+
+static uint64_t
+now_us() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static size_t
+round_up_pow2(size_t n) {
+    size_t p = 1;
+
+    while (p < n) {
+        p <<= 1;
+    }
+
+    return p;
+}
+
+/* FNV-1a, continued from 'hash' */
+static uint64_t
+fnv(uint64_t hash, const char *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) p[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/* spreads FNV's weak high bits over the whole word */
+static uint64_t
+mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/* FNV state after the table and rowkey, which the lookup hash goes on from */
+static uint64_t
+hash_row(const char *table, const char *rowkey, size_t rowkey_len) {
+    uint64_t hash = fnv(14695981039346656037ULL, table, strlen(table) + 1);
+
+    return fnv(hash, rowkey, rowkey_len);
+}
+
+static inline uint32_t *
+version_of(uint64_t row) {
+    return &versions[(row >> 40) % VERSION_SLOTS];
+}
+
+static inline uint64_t *
+block_of(uint64_t generation, uint64_t row) {
+    return generations[generation % GENERATIONS] + (row & block_mask) * BLOCK_WORDS;
+}
+
+static inline exact_entry_t *
+bucket_of(uint64_t row) {
+    return &exact[((row >> 20) & exact_mask) * EXACT_WAYS];
+}
+
+static inline pthread_mutex_t *
+lock_of(uint64_t row) {
+    return &exact_locks[((row >> 20) & exact_mask) % EXACT_LOCKS];
+}
+
+static bool
+block_contains(const uint64_t *block, uint64_t lookup) {
+    for (int i = 0; i < BITS_PER_KEY; i++) {
+        unsigned int bit = (lookup >> (i * 9)) % BLOCK_BITS;
+
+        if (!(__atomic_load_n(&block[bit / 64], __ATOMIC_RELAXED) & (1ULL << (bit % 64)))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void
+block_add(uint64_t *block, uint64_t lookup) {
+    for (int i = 0; i < BITS_PER_KEY; i++) {
+        unsigned int bit = (lookup >> (i * 9)) % BLOCK_BITS;
+
+        __atomic_fetch_or(&block[bit / 64], 1ULL << (bit % 64), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Turns the oldest generation, which is no longer checked, into the newest
+ * once every half TTL. Whichever caller notices first does it.
+ */
+static void
+rotate_if_due(uint64_t now) {
+    uint64_t due = __atomic_load_n(&next_rotation_us, __ATOMIC_RELAXED);
+
+    if (now < due || !__sync_bool_compare_and_swap(&next_rotation_us, due, now + rotation_us)) {
+        return;
+    }
+
+    uint64_t current = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+
+    memset(generations[(current + 1) % GENERATIONS], 0,
+           (block_mask + 1) * BLOCK_WORDS * sizeof(uint64_t));
+
+    __atomic_store_n(&epoch, current + 1, __ATOMIC_RELEASE);
+    __sync_add_and_fetch(&rotations, 1);
+}
+
+static exact_entry_t *
+exact_find(exact_entry_t *bucket, const miss_key_t *key) {
+    for (int w = 0; w < EXACT_WAYS; w++) {
+        if (bucket[w].expires_us != 0 && bucket[w].row == key->row
+            && bucket[w].lookup == key->lookup) {
+            return &bucket[w];
+        }
+    }
+
+    return NULL;
+}
+
+/* drops every trace of a row, from the filter and from the exact map */
+static void
+clear_row(uint64_t row) {
+    if (generations[0] != NULL) {
+        for (int g = 0; g < GENERATIONS; g++) {
+            uint64_t *block = block_of(g, row);
+
+            for (int w = 0; w < BLOCK_WORDS; w++) {
+                __atomic_store_n(&block[w], 0, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    if (exact != NULL) {
+        exact_entry_t *bucket = bucket_of(row);
+
+        pthread_mutex_lock(lock_of(row));
+
+        for (int w = 0; w < EXACT_WAYS; w++) {
+            if (bucket[w].expires_us != 0 && bucket[w].row == row) {
+                bucket[w].expires_us = 0;
+                __sync_sub_and_fetch(&exact_entries, 1);
+            }
+        }
+
+        pthread_mutex_unlock(lock_of(row));
+    }
+}
+
+int
+miss_filter_init(size_t filter_bytes, size_t exact_capacity, long ttl_ms) {
+    if (filter_bytes == 0 && exact_capacity == 0) {
+        return 0;
+    }
+
+    if (ttl_ms <= 0) {
+        return EINVAL;
+    }
+
+    if (filter_bytes != 0) {
+        size_t blocks = round_up_pow2(filter_bytes / GENERATIONS / (BLOCK_WORDS * sizeof(uint64_t)));
+
+        for (int g = 0; g < GENERATIONS; g++) {
+            void *generation = NULL;
+
+            // a block must not straddle two cache lines
+            if (posix_memalign(&generation, BLOCK_WORDS * sizeof(uint64_t),
+                               blocks * BLOCK_WORDS * sizeof(uint64_t)) != 0) {
+                for (int j = 0; j < g; j++) {
+                    free(generations[j]);
+                    generations[j] = NULL;
+                }
+
+                return ENOMEM;
+            }
+
+            memset(generation, 0, blocks * BLOCK_WORDS * sizeof(uint64_t));
+            generations[g] = generation;
+        }
+
+        block_mask = blocks - 1;
+    }
+
+    if (exact_capacity != 0) {
+        size_t buckets = round_up_pow2((exact_capacity + EXACT_WAYS - 1) / EXACT_WAYS);
+
+        exact = calloc(buckets * EXACT_WAYS, sizeof(exact_entry_t));
+
+        if (exact == NULL) {
+            for (int g = 0; g < GENERATIONS; g++) {
+                free(generations[g]);
+                generations[g] = NULL;
+            }
+
+            return ENOMEM;
+        }
+
+        exact_mask = buckets - 1;
+
+        for (int i = 0; i < EXACT_LOCKS; i++) {
+            pthread_mutex_init(&exact_locks[i], NULL);
+        }
+    }
+
+    ttl_us = (uint64_t) ttl_ms * 1000;
+    rotation_us = ttl_us / 2 ? ttl_us / 2 : 1;
+    next_rotation_us = now_us() + rotation_us;
+    enabled = 1;
+
+    return 0;
+}
+
+int
+miss_filter_enabled() {
+    return enabled;
+}
+
+void
+miss_filter_key(const char *table, const char *rowkey, size_t rowkey_len,
+                const char *family, const char *qualifier, miss_key_t *key) {
+    uint64_t hash = hash_row(table, rowkey, rowkey_len);
+
+    key->row = mix(hash);
+
+    // the separators keep "cf:q" apart from "c:fq"
+    hash = fnv(hash, "", 1);
+    hash = family ? fnv(hash, family, strlen(family) + 1) : hash;
+    hash = qualifier ? fnv(hash, qualifier, strlen(qualifier)) : hash;
+
+    key->lookup = mix(hash);
+}
+
+bool
+miss_filter_contains(const miss_key_t *key) {
+    uint64_t now = now_us();
+
+    if (generations[0] != NULL) {
+        rotate_if_due(now);
+
+        uint64_t current = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+
+        if (!block_contains(block_of(current, key->row), key->lookup)
+            && !block_contains(block_of(current + GENERATIONS - 1, key->row), key->lookup)) {
+            return false;
+        }
+
+        if (exact == NULL) {
+            return true;
+        }
+    }
+
+    pthread_mutex_lock(lock_of(key->row));
+
+    exact_entry_t *entry = exact_find(bucket_of(key->row), key);
+    bool found = entry != NULL && entry->expires_us > now;
+
+    pthread_mutex_unlock(lock_of(key->row));
+
+    if (!found && generations[0] != NULL) {
+        __sync_add_and_fetch(&false_positives, 1);
+    }
+
+    return found;
+}
+
+uint32_t
+miss_filter_version(const miss_key_t *key) {
+    return __atomic_load_n(version_of(key->row), __ATOMIC_SEQ_CST);
+}
+
+void
+miss_filter_add(const miss_key_t *key, uint32_t version) {
+    uint32_t *row_version = version_of(key->row);
+
+    if (__atomic_load_n(row_version, __ATOMIC_SEQ_CST) != version) {
+        return;
+    }
+
+    uint64_t now = now_us();
+
+    if (generations[0] != NULL) {
+        rotate_if_due(now);
+        block_add(block_of(__atomic_load_n(&epoch, __ATOMIC_ACQUIRE), key->row), key->lookup);
+    }
+
+    if (exact != NULL) {
+        exact_entry_t *bucket = bucket_of(key->row);
+
+        pthread_mutex_lock(lock_of(key->row));
+
+        exact_entry_t *entry = exact_find(bucket, key);
+
+        // else a free way, or the one closest to expiring
+        for (int w = 0; entry == NULL && w < EXACT_WAYS; w++) {
+            if (bucket[w].expires_us == 0) {
+                entry = &bucket[w];
+                __sync_add_and_fetch(&exact_entries, 1);
+            }
+        }
+
+        if (entry == NULL) {
+            entry = &bucket[0];
+
+            for (int w = 1; w < EXACT_WAYS; w++) {
+                if (bucket[w].expires_us < entry->expires_us) {
+                    entry = &bucket[w];
+                }
+            }
+        }
+
+        entry->row = key->row;
+        entry->lookup = key->lookup;
+        entry->expires_us = now + ttl_us;
+
+        pthread_mutex_unlock(lock_of(key->row));
+    }
+
+    // an invalidation which ran while this was being added may have missed it
+    if (__atomic_load_n(row_version, __ATOMIC_SEQ_CST) != version) {
+        clear_row(key->row);
+    }
+}
+
+void
+miss_filter_invalidate_row(const char *table, const char *rowkey, size_t rowkey_len) {
+    if (!enabled) {
+        return;
+    }
+
+    uint64_t row = mix(hash_row(table, rowkey, rowkey_len));
+
+    __atomic_add_fetch(version_of(row), 1, __ATOMIC_SEQ_CST);
+    clear_row(row);
+}
+
+void
+miss_filter_get_stats(miss_filter_stats_t *stats) {
+    stats->false_positives = __atomic_load_n(&false_positives, __ATOMIC_RELAXED);
+    stats->rotations = __atomic_load_n(&rotations, __ATOMIC_RELAXED);
+    stats->exact_entries = __atomic_load_n(&exact_entries, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,117 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_MISS_FILTER_H_
+#define HEDIS_CONNECTOR_MISS_FILTER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * Negative cache of lookups which found no row, so that repeating one skips
+ * the round trip.
+ *
+ * The filter is a blocked Bloom filter: all the bits of a lookup fall in one
+ * 64-byte block picked by its table and rowkey, so a check touches a single
+ * cache line and a write clears every column variant of its row by zeroing
+ * that block. It is split into three generations, rotated every half TTL,
+ * of which the two newest are checked; a miss is forgotten between half a
+ * TTL and a TTL after it was added. A filter hit may be a false positive.
+ *
+ * The optional exact map holds the hashes of the missed lookups themselves,
+ * each with its own expiry, in 4-way buckets which evict their oldest entry.
+ * With it, a filter hit is confirmed before it is served; on its own, every
+ * check goes to the map.
+ *
+ * Each row hashes to a version which an invalidation bumps. A miss is only
+ * added if the version it saw when its get was sent is still current, so an
+ * answer which raced with a write cannot hide the row.
+ */
+typedef struct miss_key_t_ {
+    uint64_t row;               /* table and rowkey */
+    uint64_t lookup;            /* table, rowkey, family and qualifier */
+} miss_key_t;
+
+typedef struct miss_filter_stats_t_ {
+    uint64_t false_positives;   /* filter hits the exact map turned down */
+    uint64_t rotations;
+    uint64_t exact_entries;
+} miss_filter_stats_t;
+
+/**
+ * Sets up the filter with 'filter_bytes' over its three generations, each
+ * rounded up to a power of two of blocks, and the exact map with room for
+ * 'exact_entries', rounded up to a power of two of buckets. Either may be 0;
+ * the negative cache is enabled when one is set.
+ *
+ * @returns 0 on success, an errno value otherwise.
+ */
+int
+miss_filter_init(size_t filter_bytes, size_t exact_entries, long ttl_ms);
+
+/**
+ * @returns non-zero once miss_filter_init() has enabled the negative cache.
+ */
+int
+miss_filter_enabled();
+
+/**
+ * Hashes a lookup. 'family' and 'qualifier' may be NULL.
+ */
+void
+miss_filter_key(const char *table, const char *rowkey, size_t rowkey_len,
+                const char *family, const char *qualifier, miss_key_t *key);
+
+/**
+ * @returns true if 'key' missed recently.
+ */
+bool
+miss_filter_contains(const miss_key_t *key);
+
+/**
+ * @returns the version of the row of 'key', to be passed to
+ * miss_filter_add() once its get has answered.
+ */
+uint32_t
+miss_filter_version(const miss_key_t *key);
+
+/**
+ * Records that 'key' found no row, unless its row was invalidated since
+ * miss_filter_version() returned 'version'.
+ */
+void
+miss_filter_add(const miss_key_t *key, uint32_t version);
+
+/**
+ * Forgets every recorded miss of a row, whatever its family and qualifier.
+ */
+void
+miss_filter_invalidate_row(const char *table, const char *rowkey, size_t rowkey_len);
+
+void
+miss_filter_get_stats(miss_filter_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_MISS_FILTER_H_ */
@@ -0,0 +1,176 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "pool.h"
+
+#line __LINE__ "pool.c"
+
+/* objects are linked through their first word while they are free */
+#define NEXT(object) (*(void **) (object))
+
+typedef struct pool_cache_t_ {
+    object_pool_t *pool;
+    void *head;
+    size_t count;
+} pool_cache_t;
+
+/**
+ * Moves up to 'count' objects of 'cache' to the shared list, and frees
+ * those that do not fit.
+ */
+static void
+spill(pool_cache_t *cache, size_t count) {
+    object_pool_t *pool = cache->pool;
+    void *drop = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    for (; count > 0 && cache->head != NULL; count--) {
+        void *object = cache->head;
+
+        cache->head = NEXT(object);
+        cache->count--;
+
+        if (pool->shared_count < OBJECT_POOL_SHARED) {
+            NEXT(object) = pool->shared;
+            pool->shared = object;
+            pool->shared_count++;
+        } else {
+            NEXT(object) = drop;
+            drop = object;
+        }
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    while (drop != NULL) {
+        void *object = drop;
+
+        drop = NEXT(object);
+        free(object);
+    }
+}
+
+static void
+release_cache(void *arg) {
+    pool_cache_t *cache = (pool_cache_t *) arg;
+
+    spill(cache, cache->count);
+    free(cache);
+}
+
+/**
+ * @returns the cache of the calling thread, or NULL if it cannot have one
+ */
+static pool_cache_t *
+thread_cache(object_pool_t *pool) {
+    if (!__atomic_load_n(&pool->ready, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&pool->mutex);
+
+        if (!pool->ready && pthread_key_create(&pool->key, release_cache) == 0) {
+            __atomic_store_n(&pool->ready, true, __ATOMIC_RELEASE);
+        }
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (!pool->ready) {
+            return NULL;
+        }
+    }
+
+    pool_cache_t *cache = pthread_getspecific(pool->key);
+
+    if (cache == NULL) {
+        cache = malloc(sizeof(pool_cache_t));
+
+        if (cache == NULL) {
+            return NULL;
+        }
+
+        cache->pool = pool;
+        cache->head = NULL;
+        cache->count = 0;
+
+        if (pthread_setspecific(pool->key, cache) != 0) {
+            free(cache);
+
+            return NULL;
+        }
+    }
+
+    return cache;
+}
+
+void *
+object_pool_get(object_pool_t *pool) {
+    pool_cache_t *cache = thread_cache(pool);
+
+    if (cache == NULL) {
+        return malloc(pool->object_size);
+    }
+
+    if (cache->head == NULL) {
+        pthread_mutex_lock(&pool->mutex);
+
+        for (size_t i = 0; i < OBJECT_POOL_BATCH && pool->shared != NULL; i++) {
+            void *object = pool->shared;
+
+            pool->shared = NEXT(object);
+            pool->shared_count--;
+            NEXT(object) = cache->head;
+            cache->head = object;
+            cache->count++;
+        }
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (cache->head == NULL) {
+            return malloc(pool->object_size);
+        }
+    }
+
+    void *object = cache->head;
+
+    cache->head = NEXT(object);
+    cache->count--;
+
+    return object;
+}
+
+void
+object_pool_put(object_pool_t *pool, void *object) {
+    pool_cache_t *cache = thread_cache(pool);
+
+    if (cache == NULL) {
+        free(object);
+
+        return;
+    }
+
+    if (cache->count >= 2 * OBJECT_POOL_BATCH) {
+        spill(cache, OBJECT_POOL_BATCH);
+    }
+
+    NEXT(object) = cache->head;
+    cache->head = object;
+    cache->count++;
+}
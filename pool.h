@@ -0,0 +1,78 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_POOL_H_
+#define HEDIS_CONNECTOR_POOL_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * Free lists of fixed-size objects, so that the lookup path reuses the
+ * memory of earlier requests instead of going to the allocator.
+ *
+ * Each thread keeps up to 2 * OBJECT_POOL_BATCH objects of its own, so
+ * taking and giving back one takes no lock. A thread which runs out, or has
+ * too many, trades OBJECT_POOL_BATCH objects with the list shared by all
+ * threads under a lock. The shared list holds at most OBJECT_POOL_SHARED
+ * objects and frees the rest, and a thread which exits leaves its objects
+ * to it. Objects are never handed back to the allocator otherwise.
+ */
+#define OBJECT_POOL_BATCH 32
+#define OBJECT_POOL_SHARED 4096
+
+typedef struct object_pool_t_ {
+    size_t object_size;
+    bool ready;                 /* 'key' has been created */
+    pthread_key_t key;
+    pthread_mutex_t mutex;
+    void *shared;
+    size_t shared_count;
+} object_pool_t;
+
+/**
+ * Static initializer of a pool of objects of 'size' bytes. The pool sets
+ * itself up on first use.
+ */
+#define OBJECT_POOL_INITIALIZER(size) \
+    { (size) < sizeof(void *) ? sizeof(void *) : (size), false, 0, \
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+
+/**
+ * @returns an object of the pool's size, recycled if one is free, or NULL
+ * if the allocator fails. Its contents are undefined.
+ */
+void *
+object_pool_get(object_pool_t *pool);
+
+/**
+ * Gives 'object', taken from object_pool_get() of the same pool, back for
+ * reuse.
+ */
+void
+object_pool_put(object_pool_t *pool, void *object);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_POOL_H_ */
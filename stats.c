@@ -0,0 +1,355 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+#line __LINE__ "stats.c"
+
+#define SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+
+static const char *stage_names[STATS_STAGE_COUNT] = {
+    "parse", "coalesce", "send", "rpc", "result", "json",
+    "wakeup", "get", "scan_batch", "scan_json", "write"
+};
+
+static const char *counter_names[STATS_COUNTER_COUNT] = {
+    "gets", "scans", "writes", "rpcs_in_flight", "bytes_returned", "errors",
+    "timeouts", "hedges", "hedge_wins", "miss_hits", "miss_inserts"
+};
+
+/*
+ * The statistics of one thread. Only the owning thread writes them, with
+ * relaxed loads and stores so that a concurrent snapshot reads whole values.
+ */
+typedef struct stats_thread_t_ {
+    stats_snapshot_t stats;
+    struct stats_thread_t_ *prev;
+    struct stats_thread_t_ *next;
+} stats_thread_t;
+
+static __thread stats_thread_t *local_stats = NULL;
+
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static stats_thread_t *threads = NULL;
+
+/* what exited threads recorded, guarded by 'stats_mutex' */
+static stats_snapshot_t retired;
+
+static inline void
+bump(uint64_t *slot, uint64_t delta) {
+    __atomic_store_n(slot, __atomic_load_n(slot, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+}
+
+static void
+merge_histogram(stats_histogram_t *h, const stats_histogram_t *f) {
+    uint64_t count = __atomic_load_n(&f->count, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&f->max, __ATOMIC_RELAXED);
+
+    // a thread usually records only some of the stages
+    if (count == 0) {
+        return;
+    }
+
+    h->count += count;
+    h->sum += __atomic_load_n(&f->sum, __ATOMIC_RELAXED);
+
+    if (max > h->max) {
+        h->max = max;
+    }
+
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        h->buckets[b] += __atomic_load_n(&f->buckets[b], __ATOMIC_RELAXED);
+    }
+}
+
+static void
+merge(stats_snapshot_t *into, const stats_snapshot_t *from) {
+    for (int s = 0; s < STATS_STAGE_COUNT; s++) {
+        merge_histogram(&into->stages[s], &from->stages[s]);
+    }
+
+    for (int c = 0; c < STATS_COUNTER_COUNT; c++) {
+        into->counters[c] += __atomic_load_n(&from->counters[c], __ATOMIC_RELAXED);
+    }
+
+    for (int e = 0; e <= STATS_MAX_ERROR_CODE; e++) {
+        into->errors[e] += __atomic_load_n(&from->errors[e], __ATOMIC_RELAXED);
+    }
+}
+
+static void
+detach_thread(void *arg) {
+    stats_thread_t *thread = (stats_thread_t *) arg;
+
+    pthread_mutex_lock(&stats_mutex);
+
+    merge(&retired, &thread->stats);
+
+    if (thread->prev) {
+        thread->prev->next = thread->next;
+    } else {
+        threads = thread->next;
+    }
+
+    if (thread->next) {
+        thread->next->prev = thread->prev;
+    }
+
+    pthread_mutex_unlock(&stats_mutex);
+
+    local_stats = NULL;
+    free(thread);
+}
+
+static void
+create_key() {
+    pthread_key_create(&stats_key, detach_thread);
+}
+
+static stats_thread_t *
+attach_thread() {
+    stats_thread_t *thread = calloc(1, sizeof(stats_thread_t));
+
+    if (thread == NULL) {
+        return NULL;
+    }
+
+    pthread_once(&stats_once, create_key);
+    pthread_setspecific(stats_key, thread);
+
+    pthread_mutex_lock(&stats_mutex);
+
+    thread->next = threads;
+    if (threads) {
+        threads->prev = thread;
+    }
+    threads = thread;
+
+    pthread_mutex_unlock(&stats_mutex);
+
+    local_stats = thread;
+
+    return thread;
+}
+
+static inline stats_snapshot_t *
+thread_stats() {
+    stats_thread_t *thread = local_stats ? local_stats : attach_thread();
+
+    return thread ? &thread->stats : NULL;
+}
+
+static inline int
+bucket_of(uint64_t value) {
+    if (value < 2 * SUB_BUCKETS) {
+        return (int) value;
+    }
+
+    int shift = 63 - __builtin_clzll(value) - STATS_SUB_BUCKET_BITS;
+
+    return ((shift + 1) << STATS_SUB_BUCKET_BITS) + (int) (value >> shift) - SUB_BUCKETS;
+}
+
+static uint64_t
+bucket_upper_bound(int bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int shift = (bucket >> STATS_SUB_BUCKET_BITS) - 1;
+    uint64_t lower = (uint64_t) ((bucket & (SUB_BUCKETS - 1)) + SUB_BUCKETS) << shift;
+
+    return lower + (((uint64_t) 1 << shift) - 1);
+}
+
+uint64_t
+stats_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+stats_record(stats_stage_t stage, uint64_t ns) {
+    stats_snapshot_t *stats = thread_stats();
+
+    if (stats == NULL) {
+        return;
+    }
+
+    stats_histogram_t *histogram = &stats->stages[stage];
+
+    bump(&histogram->buckets[bucket_of(ns)], 1);
+    bump(&histogram->count, 1);
+    bump(&histogram->sum, ns);
+
+    if (ns > histogram->max) {
+        __atomic_store_n(&histogram->max, ns, __ATOMIC_RELAXED);
+    }
+}
+
+void
+stats_record_since(stats_stage_t stage, uint64_t start) {
+    uint64_t now = stats_now();
+
+    stats_record(stage, now > start ? now - start : 0);
+}
+
+void
+stats_add(stats_counter_t counter, int64_t delta) {
+    stats_snapshot_t *stats = thread_stats();
+
+    if (stats != NULL) {
+        bump((uint64_t *) &stats->counters[counter], (uint64_t) delta);
+    }
+}
+
+void
+stats_error(int err) {
+    stats_snapshot_t *stats = thread_stats();
+
+    if (stats != NULL) {
+        bump(&stats->errors[err > 0 && err <= STATS_MAX_ERROR_CODE ? err : 0], 1);
+        bump((uint64_t *) &stats->counters[STATS_ERRORS], 1);
+    }
+}
+
+void
+stats_snapshot(stats_snapshot_t *snapshot) {
+    memset(snapshot, 0, sizeof(stats_snapshot_t));
+
+    pthread_mutex_lock(&stats_mutex);
+
+    merge(snapshot, &retired);
+
+    for (stats_thread_t *thread = threads; thread; thread = thread->next) {
+        merge(snapshot, &thread->stats);
+    }
+
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void
+stats_stage_snapshot(stats_stage_t stage, stats_histogram_t *histogram) {
+    memset(histogram, 0, sizeof(stats_histogram_t));
+
+    pthread_mutex_lock(&stats_mutex);
+
+    merge_histogram(histogram, &retired.stages[stage]);
+
+    for (stats_thread_t *thread = threads; thread; thread = thread->next) {
+        merge_histogram(histogram, &thread->stats.stages[stage]);
+    }
+
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+uint64_t
+stats_percentile(const stats_histogram_t *histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t) (percentile / 100 * histogram->count + 0.5);
+    uint64_t seen = 0;
+
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+
+        if (seen >= rank) {
+            uint64_t bound = bucket_upper_bound(b);
+
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+static void
+append_format(json_buf_t *buf, const char *format, ...) {
+    char text[256];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (len > 0) {
+        json_buf_append(buf, text, (size_t) len < sizeof(text) ? (size_t) len : sizeof(text) - 1);
+    }
+}
+
+void
+stats_write_json(json_buf_t *buf, const stats_snapshot_t *snapshot) {
+    json_buf_append(buf, "\"stages\":{", 10);
+
+    for (int s = 0; s < STATS_STAGE_COUNT; s++) {
+        const stats_histogram_t *h = &snapshot->stages[s];
+
+        append_format(buf, "%s\"%s\":{\"count\":%llu,\"mean_us\":%.3f,"
+                      "\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,"
+                      "\"p999_us\":%.3f,\"max_us\":%.3f}",
+                      s ? "," : "", stage_names[s], (unsigned long long) h->count,
+                      h->count ? h->sum / 1e3 / h->count : 0.0,
+                      stats_percentile(h, 50) / 1e3, stats_percentile(h, 90) / 1e3,
+                      stats_percentile(h, 99) / 1e3, stats_percentile(h, 99.9) / 1e3,
+                      h->max / 1e3);
+    }
+
+    json_buf_append(buf, "},\"counters\":{", 14);
+
+    for (int c = 0; c < STATS_COUNTER_COUNT; c++) {
+        append_format(buf, "%s\"%s\":%lld", c ? "," : "", counter_names[c],
+                      (long long) snapshot->counters[c]);
+    }
+
+    json_buf_append(buf, "},\"errors\":{", 12);
+
+    int written = 0;
+
+    for (int e = 1; e <= STATS_MAX_ERROR_CODE; e++) {
+        if (snapshot->errors[e] != 0) {
+            append_format(buf, "%s\"%d\":%llu", written++ ? "," : "", e,
+                          (unsigned long long) snapshot->errors[e]);
+        }
+    }
+
+    if (snapshot->errors[0] != 0) {
+        append_format(buf, "%s\"other\":%llu", written ? "," : "",
+                      (unsigned long long) snapshot->errors[0]);
+    }
+
+    json_buf_append(buf, "}", 1);
+}
@@ -0,0 +1,152 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_STATS_H_
+#define HEDIS_CONNECTOR_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * Latency histograms and counters of the connector.
+ *
+ * Every thread records into its own copy, so recording takes no lock and
+ * no atomic read-modify-write. A snapshot sums the copies of all threads,
+ * plus whatever threads that have exited left behind.
+ *
+ * Histograms are log-linear: values below 32 ns get a bucket each, and every
+ * power of two above that is split into 16 buckets, which bounds the error
+ * of a percentile to 1/16 of its value.
+ */
+#define STATS_SUB_BUCKET_BITS 4
+#define STATS_BUCKETS ((64 - STATS_SUB_BUCKET_BITS + 1) << STATS_SUB_BUCKET_BITS)
+
+/* error codes above this one are counted together */
+#define STATS_MAX_ERROR_CODE 255
+
+typedef enum stats_stage_t_ {
+    STATS_PARSE,        /* tokenizing the command and looking up its plan */
+    STATS_COALESCE,     /* waiting in the coalescing window */
+    STATS_SEND,         /* inside hb_get_send() */
+    STATS_RPC,          /* hb_get_send() to get_callback(), JNI included */
+    STATS_RESULT,       /* reading the key and cells out of the result */
+    STATS_JSON,         /* encoding a row */
+    STATS_WAKEUP,       /* completion callback to the blocked caller resuming */
+    STATS_GET,          /* a whole blocking get_value() */
+    STATS_SCAN_BATCH,   /* hb_scanner_next() to its callback */
+    STATS_SCAN_JSON,    /* encoding a scan batch */
+    STATS_WRITE,        /* a write from submission to acknowledgement */
+    STATS_STAGE_COUNT
+} stats_stage_t;
+
+typedef enum stats_counter_t_ {
+    STATS_GETS,
+    STATS_SCANS,
+    STATS_WRITES,
+    STATS_RPCS_IN_FLIGHT,
+    STATS_BYTES_RETURNED,
+    STATS_ERRORS,
+    STATS_TIMEOUTS,
+    STATS_HEDGES,
+    STATS_HEDGE_WINS,
+    STATS_MISS_HITS,
+    STATS_MISS_INSERTS,
+    STATS_COUNTER_COUNT
+} stats_counter_t;
+
+typedef struct stats_histogram_t_ {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[STATS_BUCKETS];
+} stats_histogram_t;
+
+typedef struct stats_snapshot_t_ {
+    stats_histogram_t stages[STATS_STAGE_COUNT];
+    int64_t counters[STATS_COUNTER_COUNT];
+    uint64_t errors[STATS_MAX_ERROR_CODE + 1];  /* [0] counts the others */
+} stats_snapshot_t;
+
+/**
+ * @returns a monotonic timestamp in nanoseconds.
+ */
+uint64_t
+stats_now();
+
+/**
+ * Records 'ns' nanoseconds in the histogram of a stage.
+ */
+void
+stats_record(stats_stage_t stage, uint64_t ns);
+
+/**
+ * Records the time elapsed since 'start', a stats_now() timestamp.
+ */
+void
+stats_record_since(stats_stage_t stage, uint64_t start);
+
+/**
+ * Adds 'delta', which may be negative, to a counter.
+ */
+void
+stats_add(stats_counter_t counter, int64_t delta);
+
+/**
+ * Counts an error by its code.
+ */
+void
+stats_error(int err);
+
+/**
+ * Sums the statistics of all threads into 'snapshot'. Counts recorded
+ * concurrently may or may not be included.
+ */
+void
+stats_snapshot(stats_snapshot_t *snapshot);
+
+/**
+ * Like stats_snapshot(), for the histogram of a single stage.
+ */
+void
+stats_stage_snapshot(stats_stage_t stage, stats_histogram_t *histogram);
+
+/**
+ * @returns the upper bound of the bucket holding the 'percentile'th value
+ * (0 to 100), or 0 for an empty histogram.
+ */
+uint64_t
+stats_percentile(const stats_histogram_t *histogram, double percentile);
+
+/**
+ * Writes the "stages", "counters" and "errors" members of a JSON object,
+ * without the enclosing braces, so that the caller can add its own members.
+ * Latencies are in microseconds.
+ */
+void
+stats_write_json(json_buf_t *buf, const stats_snapshot_t *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_STATS_H_ */
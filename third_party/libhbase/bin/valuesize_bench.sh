@@ -0,0 +1,45 @@
+#
+#/**
+# * Copyright The Apache Software Foundation
+# *
+# * Licensed to the Apache Software Foundation (ASF) under one
+# * or more contributor license agreements.  See the NOTICE file
+# * distributed with this work for additional information
+# * regarding copyright ownership.  The ASF licenses this file
+# * to you under the Apache License, Version 2.0 (the
+# * "License"); you may not use this file except in compliance
+# * with the License.  You may obtain a copy of the License at
+# *
+# *     http://www.apache.org/licenses/LICENSE-2.0
+# *
+# * Unless required by applicable law or agreed to in writing, software
+# * distributed under the License is distributed on an "AS IS" BASIS,
+# * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# * See the License for the specific language governing permissions and
+# * limitations under the License.
+# */
+#
+# Runs the perftest JNI benchmark over value sizes from 100 B to 1 MB, with
+# and without direct buffers. No cluster is needed. The JVM's GC log of
+# each run is written next to the perftest logs and shows the heap
+# allocation of each mode.
+#
+bin=`dirname "$0"`
+bin=`cd "$bin">/dev/null; pwd`
+LOG_DIR=`cd "$bin/..">/dev/null; pwd`/logs
+mkdir -p ${LOG_DIR}
+
+TOTAL_BYTES=${TOTAL_BYTES:-1073741824}
+BASE_OPTS="${LIBHBASE_OPTS}"
+
+for size in 100 1024 10240 102400 1048576; do
+  numOps=$((TOTAL_BYTES / size))
+  if [ ${numOps} -gt 1000000 ]; then
+    numOps=1000000
+  fi
+  for direct in false true; do
+    export LIBHBASE_OPTS="${BASE_OPTS} -verbose:gc -XX:+PrintGCDetails -Xloggc:${LOG_DIR}/gc-${size}-${direct}.log"
+    "$bin"/perftest.sh -jniBench true -numOps ${numOps} \
+        -valueSize ${size} -directBuffers ${direct} | grep "puts of"
+  done
+done
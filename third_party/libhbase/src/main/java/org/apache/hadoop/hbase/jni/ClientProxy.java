@@ -64,6 +64,17 @@ public class ClientProxy implements Closeable {
             callback, client, extra));
   }
 
+  /**
+   * Locates the first region of the table, which leaves its location in
+   * the client's region cache. Completes like a flush.
+   */
+  public void prefetchRegions(final byte[] table,
+      final long callback, final long client, final long extra) {
+    this.client_.ensureTableExists(table).addBoth(
+        new FlushCallbackHandler<Object, Object>(
+            callback, client, extra));
+  }
+
   @Override
   public void close() throws IOException {
     close(0, 0, 0);
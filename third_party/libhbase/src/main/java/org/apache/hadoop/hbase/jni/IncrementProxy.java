@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+package org.apache.hadoop.hbase.jni;
+
+import java.util.ArrayList;
+
+import org.apache.hadoop.hbase.client.Durability;
+import org.apache.hadoop.hbase.client.Increment;
+import org.apache.hadoop.hbase.client.Mutation;
+import org.hbase.async.AtomicIncrementRequest;
+import org.hbase.async.Bytes;
+import org.hbase.async.HBaseClient;
+import org.hbase.async.KeyValue;
+
+import com.stumbleupon.async.Callback;
+import com.stumbleupon.async.Deferred;
+
+/**
+ * An atomic increment of a single column, which is all asynchbase supports.
+ * The mutation callback receives a result holding the new value of the
+ * column as an 8-byte big-endian long.
+ */
+public class IncrementProxy extends MutationProxy {
+  private byte[] family_ = null;
+  private byte[] qualifier_ = null;
+  private long amount_ = 0;
+
+  public IncrementProxy(final byte[] row) {
+    this.row_ = row;
+  }
+
+  public void setColumn(final byte[] family,
+      final byte[] qualifier, final long amount) {
+    family_ = family;
+    qualifier_ = qualifier;
+    amount_ = amount;
+  }
+
+  @Override
+  public Mutation toHBaseMutation() {
+    final Increment increment = new Increment(row_);
+    increment.setDurability(durability_);
+    increment.addColumn(family_, qualifier_, amount_);
+    return increment;
+  }
+
+  @Override
+  @SuppressWarnings({ "unchecked", "rawtypes" })
+  public void send(final HBaseClient client,
+      final MutationCallbackHandler<Object, Object> cbh) {
+    final AtomicIncrementRequest incr = new AtomicIncrementRequest(
+        getTable(), getRow(), family_, qualifier_, amount_);
+    // buffered increments of the same column are coalesced by the client
+    final Deferred<Long> newValue = isBufferable()
+        ? client.bufferAtomicIncrement(incr)
+        : client.atomicIncrement(incr, getDurability() != Durability.SKIP_WAL);
+    final Deferred result = newValue.addCallback(
+        new Callback<ArrayList<KeyValue>, Long>() {
+          public ArrayList<KeyValue> call(final Long value) {
+            final ArrayList<KeyValue> kvs = new ArrayList<KeyValue>(1);
+            kvs.add(new KeyValue(getRow(), family_, qualifier_,
+                Bytes.fromLong(value)));
+            return kvs;
+          }
+        });
+    result.addBoth(cbh);
+  }
+}
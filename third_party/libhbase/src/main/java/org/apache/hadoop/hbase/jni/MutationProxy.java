@@ -18,6 +18,7 @@
  */
 package org.apache.hadoop.hbase.jni;
 
+import java.nio.ByteBuffer;
 import java.util.ArrayList;
 import java.util.List;
 import java.util.Map;
@@ -55,6 +56,17 @@ public abstract class MutationProxy extends RowProxy {
     return this;
   }
 
+  /**
+   * Adds a column whose value is read from a (typically direct) buffer.
+   * The value is copied once into the heap array that asynchbase requires.
+   */
+  public MutationProxy addColumn(final byte[] family,
+      final byte[] qualifier, final long ts, final ByteBuffer value) {
+    final byte[] valueBytes = new byte[value.remaining()];
+    value.get(valueBytes);
+    return addColumn(family, qualifier, ts, valueBytes);
+  }
+
   public Durability getDurability() {
     return durability_;
   }
@@ -18,6 +18,7 @@
  */
 package org.apache.hadoop.hbase.jni;
 
+import java.nio.ByteBuffer;
 import java.util.ArrayList;
 import java.util.Collections;
 import java.util.Comparator;
@@ -28,6 +29,9 @@ import org.hbase.async.KeyValue;
 
 public class ResultProxy {
 
+  /** family length, qualifier length, value length and timestamp */
+  static final int PACKED_CELL_HEADER_SIZE = 4 + 4 + 4 + 8;
+
   protected ArrayList<KeyValue> kvList;
   private byte[] namespace;
   private byte[] table;
@@ -91,6 +95,35 @@ public class ResultProxy {
     return kvList.get(cellIndex).timestamp();
   }
 
+  /**
+   * Packs all cells into one array, so that native code can read the row
+   * with a single JNI call. The array holds a big endian header per cell
+   * (family, qualifier and value lengths as ints and the timestamp as a
+   * long) followed by the family, qualifier and value of each cell.
+   */
+  byte[] getPackedCells() {
+    final int cellCount = getCellCount();
+    int size = cellCount * PACKED_CELL_HEADER_SIZE;
+    for (int i = 0; i < cellCount; i++) {
+      final KeyValue kv = kvList.get(i);
+      size += kv.family().length + kv.qualifier().length + kv.value().length;
+    }
+
+    final ByteBuffer packed = ByteBuffer.allocate(size);
+    for (int i = 0; i < cellCount; i++) {
+      final KeyValue kv = kvList.get(i);
+      packed.putInt(kv.family().length)
+            .putInt(kv.qualifier().length)
+            .putInt(kv.value().length)
+            .putLong(kv.timestamp());
+    }
+    for (int i = 0; i < cellCount; i++) {
+      final KeyValue kv = kvList.get(i);
+      packed.put(kv.family()).put(kv.qualifier()).put(kv.value());
+    }
+    return packed.array();
+  }
+
   int getCellCount() {
     return kvList != null ? kvList.size() : 0;
   }
@@ -29,6 +29,8 @@ public class ScannerProxy extends RowProxy {
   private ClientProxy clientProxy_ = null;
   private Scanner scanner_ = null;
   private byte[] endRow_ = null;
+  private byte[] family_ = null;
+  private byte[] qualifier_ = null;
   private int maxNumRows_ = -1;
   private int numVersions_ = -1;
 
@@ -50,6 +52,12 @@ public class ScannerProxy extends RowProxy {
     if (numVersions_ != -1) {
       scanner_.setMaxVersions(numVersions_);
     }
+    if (family_ != null) {
+      scanner_.setFamily(family_);
+      if (qualifier_ != null) {
+        scanner_.setQualifier(qualifier_);
+      }
+    }
   }
 
   public void next(final long callback, final long scanner,
@@ -80,4 +88,9 @@ public class ScannerProxy extends RowProxy {
   public void setEndRow(byte[] endRow) {
     endRow_ = endRow;
   }
+
+  public void setColumn(byte[] family, byte[] qualifier) {
+    family_ = family;
+    qualifier_ = qualifier;
+  }
 }
@@ -19,6 +19,7 @@
 
 #include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -122,15 +123,317 @@ time_now(char *now_str) {
   return now_str;
 }
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
 static const char *DBG_LEVEL_STR[] = {
     "?????", "FATAL", "ERROR",
     "WARN ", "INFO ", "DEBUG", "TRACE"
 };
 
+#ifdef THREADED
+
+/**
+ * Asynchronous writer
+ *
+ * hb_log_message() copies each record into a ring buffer owned by the
+ * calling thread and returns without a system call. A background thread
+ * drains the rings, formats the timestamps (the date part only once per
+ * second) and flushes the stream once all rings are empty. A record that
+ * does not fit in its ring is dropped rather than waited for, and the writer
+ * reports how many were lost. Records of one thread stay in order; records
+ * of different threads may interleave slightly out of time order.
+ */
+#define LOG_RING_SIZE       (64 * 1024)   // bytes, a power of two
+#define LOG_RECORD_ALIGN    64
+#define LOG_MAX_MESSAGE     (LOG_RING_SIZE / 4 - sizeof(log_record) - 1)
+#define LOG_WRITER_IDLE_MS  10
+#define LOG_PADDING         (-1)
+
+typedef struct log_record_ {
+  uint32_t size;      // of the whole record, padded to LOG_RECORD_ALIGN
+  int32_t level;      // or LOG_PADDING up to the end of the ring
+  int32_t line;
+  pid_t pid;
+  unsigned long thread;
+  const char *fileName;
+  const char *funcName;
+  struct timespec time;
+  // followed by the NUL terminated message
+} log_record;
+
+typedef struct log_ring_ {
+  uint64_t head;      // advanced by the writer
+  char pad1[56];
+  uint64_t tail;      // advanced by the owning thread
+  char pad2[56];
+  int orphaned;       // set once the owning thread has exited
+  struct log_ring_ *next;
+  char data[LOG_RING_SIZE];
+} log_ring;
+
+static pthread_once_t writerOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t ringKey;
+static pthread_mutex_t ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static log_ring *rings = 0;
+static bool writerRunning = false;
+static bool writerStopped = false;
+static pthread_mutex_t writerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writerCond = PTHREAD_COND_INITIALIZER;
+static uint64_t droppedRecords = 0;
+static __thread log_ring *localRing = 0;
+
+static void
+write_line(FILE *stream, const struct timespec *time, int32_t level, pid_t pid,
+    unsigned long thread, const char *fileName, const char *funcName,
+    int line, const char *message) {
+  static time_t cachedSecond = (time_t)-1;
+  static char cachedDate[32];
+
+  // clone the format used by log4j ISO8601DateFormat
+  // specifically: "yyyy-MM-dd HH:mm:ss,SSS"
+  if (time->tv_sec != cachedSecond) {
+    struct tm lt;
+    localtime_r(&time->tv_sec, &lt);
+    strftime(cachedDate, sizeof(cachedDate), "%Y-%m-%d %H:%M:%S", &lt);
+    cachedSecond = time->tv_sec;
+  }
+
+  fprintf(stream, "%s,%03d %s %d(0x%lx)@%s(%s#%d): %s\n",
+      cachedDate, (int)(time->tv_nsec / 1000000), DBG_LEVEL_STR[level], pid,
+      thread, fileName, funcName, line, message);
+}
+
+/**
+ * Writes out every published record. Called by the writer thread and at
+ * exit, serialized by 'ringsLock'.
+ *
+ * @returns the number of records written.
+ */
+static size_t
+drain_rings() {
+  size_t written = 0;
+
+  pthread_mutex_lock(&ringsLock);
+
+  if (writerStopped) {
+    pthread_mutex_unlock(&ringsLock);
+    return 0;
+  }
+
+  FILE *stream = LOGSTREAM;
+  log_ring **link = &rings;
+
+  while (*link) {
+    log_ring *ring = *link;
+    // read before the tail, so that an orphan is seen with all its records
+    int orphaned = __atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE);
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint64_t head = ring->head;
+
+    while (head < tail) {
+      const log_record *record =
+          (const log_record *)(ring->data + (head & (LOG_RING_SIZE - 1)));
+
+      if (record->level != LOG_PADDING) {
+        write_line(stream, &record->time, record->level, record->pid,
+            record->thread, record->fileName, record->funcName, record->line,
+            (const char *)(record + 1));
+        written++;
+      }
+
+      head += record->size;
+    }
+
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+    if (orphaned) {
+      *link = ring->next;
+      free(ring);
+    } else {
+      link = &ring->next;
+    }
+  }
+
+  static uint64_t reportedDrops = 0;
+  uint64_t drops = __atomic_load_n(&droppedRecords, __ATOMIC_RELAXED);
+
+  if (drops != reportedDrops) {
+    struct timespec now;
+    char message[64];
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    snprintf(message, sizeof(message), "Dropped %llu log records.",
+        (unsigned long long)(drops - reportedDrops));
+    write_line(stream, &now, HBASE_LOG_LEVEL_WARN, getpid(),
+        (unsigned long int)pthread_self(), "hbase_log.cc", __func__,
+        __LINE__, message);
+    reportedDrops = drops;
+    written++;
+  }
+
+  if (written > 0) {
+    fflush(stream);
+  }
+
+  pthread_mutex_unlock(&ringsLock);
+
+  return written;
+}
+
+static void *
+writer_run(void *arg) {
+  for (;;) {
+    if (drain_rings() > 0) {
+      continue;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += LOG_WRITER_IDLE_MS * 1000000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+
+    pthread_mutex_lock(&writerLock);
+    pthread_cond_timedwait(&writerCond, &writerLock, &deadline);
+    pthread_mutex_unlock(&writerLock);
+  }
+
+  return 0;
+}
+
+/**
+ * Writes out what is left at exit, then falls back to synchronous writes
+ * so that nothing is written to a stream being closed.
+ */
+static void
+stop_writer() {
+  drain_rings();
+
+  pthread_mutex_lock(&ringsLock);
+  writerStopped = true;
+  pthread_mutex_unlock(&ringsLock);
+}
+
+static void
+orphan_ring(void *p) {
+  localRing = 0;
+  __atomic_store_n(&((log_ring *)p)->orphaned, 1, __ATOMIC_RELEASE);
+}
+
+static void
+start_writer() {
+  pthread_t writer;
+
+  if (pthread_key_create(&ringKey, orphan_ring) != 0) {
+    return;
+  }
+
+  if (pthread_create(&writer, 0, writer_run, 0) != 0) {
+    return;
+  }
+
+  pthread_detach(writer);
+  atexit(stop_writer);
+  writerRunning = true;
+}
+
+static log_ring *
+get_ring() {
+  if (localRing) {
+    return localRing;
+  }
+
+  pthread_once(&writerOnce, start_writer);
+
+  if (!writerRunning) {
+    return 0;
+  }
+
+  log_ring *ring = (log_ring *)calloc(1, sizeof(log_ring));
+  if (!ring) {
+    return 0;
+  }
+
+  pthread_setspecific(ringKey, ring);
+
+  pthread_mutex_lock(&ringsLock);
+  ring->next = rings;
+  rings = ring;
+  pthread_mutex_unlock(&ringsLock);
+
+  localRing = ring;
+  return ring;
+}
+
+/**
+ * Copies a record into the ring of the calling thread.
+ *
+ * @returns false if the caller has to write the record itself.
+ */
+static bool
+enqueue_record(HBaseLogLevel curLevel, int line, const char *fileName,
+    const char *funcName, const char *message, pid_t pid) {
+  log_ring *ring = get_ring();
+
+  if (!ring || __atomic_load_n(&writerStopped, __ATOMIC_RELAXED)) {
+    return false;
+  }
+
+  size_t length = strlen(message);
+  if (length > LOG_MAX_MESSAGE) {
+    length = LOG_MAX_MESSAGE;
+  }
+
+  uint32_t size = (sizeof(log_record) + length + 1 + LOG_RECORD_ALIGN - 1)
+      & ~(uint32_t)(LOG_RECORD_ALIGN - 1);
+  uint64_t tail = ring->tail;
+  uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  size_t offset = tail & (LOG_RING_SIZE - 1);
+  size_t contiguous = LOG_RING_SIZE - offset;
+  size_t needed = size + (size > contiguous ? contiguous : 0);
+
+  if (tail + needed - head > LOG_RING_SIZE) {
+    __atomic_fetch_add(&droppedRecords, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&writerCond);
+    return true;
+  }
+
+  if (size > contiguous) {
+    // records never wrap; skip what is left of the ring
+    log_record *padding = (log_record *)(ring->data + offset);
+    padding->size = contiguous;
+    padding->level = LOG_PADDING;
+    tail += contiguous;
+    offset = 0;
+  }
+
+  log_record *record = (log_record *)(ring->data + offset);
+  record->size = size;
+  record->level = curLevel;
+  record->line = line;
+  record->pid = pid;
+  record->thread = (unsigned long int)pthread_self();
+  record->fileName = fileName;
+  record->funcName = funcName;
+  clock_gettime(CLOCK_REALTIME, &record->time);
+  memcpy(record + 1, message, length);
+  ((char *)(record + 1))[length] = '\0';
+
+  __atomic_store_n(&ring->tail, tail + size, __ATOMIC_RELEASE);
+
+  // the writer polls; only errors and a filling ring are worth a wakeup
+  if (curLevel <= HBASE_LOG_LEVEL_ERROR
+      || tail + size - head > LOG_RING_SIZE / 2) {
+    pthread_cond_signal(&writerCond);
+  }
+
+  return true;
+}
+
+#endif // #ifdef THREADED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 HBASE_API void
 hb_log_message(
     HBaseLogLevel curLevel,
@@ -151,6 +454,10 @@ hb_log_message(
       time_now(get_time_buffer()), DBG_LEVEL_STR[curLevel],
       pid, fileName, funcName, line, message);
 #else
+  if (enqueue_record(curLevel, line, fileName, funcName, message, pid)) {
+    return;
+  }
+
   fprintf(LOGSTREAM, "%s %s %d(0x%lx)@%s(%s#%d): %s\n",
       time_now(get_time_buffer()), DBG_LEVEL_STR[curLevel], pid,
       (unsigned long int)pthread_self(), fileName, funcName, line, message);
@@ -36,6 +36,8 @@ const char *Msgs::ERR_CLIENT_NULL = "'hb_client_t' is NULL.";
 
 const char *Msgs::ERR_CLIENTPTR_NULL = "'hb_client_t*' is NULL.";
 
+const char *Msgs::ERR_CALLBACK_NULL = "'cb' is NULL.";
+
 const char *Msgs::ERR_TBL_NAME_NULL = "'tableName' is NULL.";
 
 const char *Msgs::ERR_HTBL_NULL = "'hb_table_t' is NULL.";
@@ -100,6 +102,10 @@ const char *Msgs::ERR_DEL_NULL = "'hb_delete_t' is NULL.";
 
 const char *Msgs::ERR_DELPTR_NULL = "'hb_delete_t*' is NULL.";
 
+const char *Msgs::ERR_INCR_NULL = "'hb_increment_t' is NULL.";
+
+const char *Msgs::ERR_INCRPTR_NULL = "'hb_increment_t*' is NULL.";
+
 const char *Msgs::ERR_GET_NULL = "'hb_get_t' is NULL.";
 
 const char *Msgs::ERR_GETPTR_NULL = "'hb_get_t*' is NULL.";
@@ -32,6 +32,7 @@ public:
 
   static const char *ERR_CLIENT_NULL;
   static const char *ERR_CLIENTPTR_NULL;
+  static const char *ERR_CALLBACK_NULL;
 
   static const char *ERR_TBL_NULL;
   static const char *ERR_TBL_LEN;
@@ -72,6 +73,9 @@ public:
   static const char *ERR_DEL_NULL;
   static const char *ERR_DELPTR_NULL;
 
+  static const char *ERR_INCR_NULL;
+  static const char *ERR_INCRPTR_NULL;
+
   static const char *ERR_GET_NULL;
   static const char *ERR_GETPTR_NULL;
 
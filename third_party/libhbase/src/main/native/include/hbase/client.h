@@ -48,6 +48,19 @@ hb_client_flush(
     hb_client_flush_cb cb,
     void *extra);
 
+/**
+ * Locates the first region of 'table' and caches its location in the client,
+ * so that the first request to the table does not wait for the lookup in
+ * ZooKeeper and META. The callback is invoked once it has been located, with
+ * ENOENT if the table does not exist.
+ */
+HBASE_API int32_t
+hb_client_prefetch_regions(
+    hb_client_t client,
+    const char *table,
+    hb_client_prefetch_cb cb,
+    void *extra);
+
 /**
  * Cleans up hb_client_t handle and release any held resources.
  * The callback is called after the connections are closed, but just before the
@@ -43,8 +43,6 @@ hb_delete_create(
     hb_delete_t *delete_ptr);
 
 /**
- * @NotYetImplemented
- *
  * Creates a structure for increment operation and return its handle.
  */
 HBASE_API int32_t
@@ -109,8 +107,9 @@ hb_mutation_set_table(
 /**
  * Sets whether or not this RPC can be buffered on the client side.
  *
- * Currently only puts and deletes can be buffered. Calling this for
- * any other mutation type will return EINVAL.
+ * Currently only puts, deletes and increments can be buffered. Buffered
+ * increments of the same column are coalesced into one RPC. Calling this
+ * for any other mutation type will return ENOTSUP.
  *
  * The default is true.
  */
@@ -119,6 +118,19 @@ hb_mutation_set_bufferable(
     hb_mutation_t mutation,
     const bool bufferable);
 
+/**
+ * Sets whether the values of cells added to this mutation are handed to the
+ * JVM as direct ByteBuffers wrapping the caller's memory, instead of being
+ * copied into Java byte arrays through JNI. Buffers passed to hb_put_add_*()
+ * must stay valid and unmodified until that call returns.
+ *
+ * The default is false.
+ */
+HBASE_API int32_t
+hb_mutation_set_direct_buffers(
+    hb_mutation_t mutation,
+    const bool direct_buffers);
+
 /**
  * Sets the row key for the mutation.
  */
@@ -200,10 +212,12 @@ hb_delete_set_timestamp(
     const int64_t timestamp);
 
 /**
- * @NotYetImplemented
- *
  * Add a column and the amount by which its value to be incremented
- * to the increment operation.
+ * to the increment operation. Only one column per increment is supported;
+ * adding a second one returns ENOTSUP.
+ *
+ * The mutation callback receives a result whose cell holds the new value
+ * of the column as an 8-byte big-endian integer.
  */
 HBASE_API int32_t
 hb_increment_add_column(
@@ -107,6 +107,18 @@ hb_scanner_set_num_max_rows(
     hb_scanner_t scanner,
     const size_t cache_size);
 
+/**
+ * Restricts the scanner to one column family, and to one qualifier of it
+ * unless 'qualifier' is NULL.
+ */
+HBASE_API int32_t
+hb_scanner_set_column(
+    hb_scanner_t scanner,
+    const byte_t *family,
+    const size_t family_len,
+    const byte_t *qualifier,
+    const size_t qualifier_len);
+
 /**
  * @NotYetImplemented
  *
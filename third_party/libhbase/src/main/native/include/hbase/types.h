@@ -194,6 +194,18 @@ typedef void (*hb_client_flush_cb) (
       hb_client_t client,
       void *extra);
 
+/**
+ * Region prefetch callback typedef
+ * This will be invoked once the regions of the table have been located.
+ *
+ * Refer to the section on error code for the list of possible values
+ * for 'err'. A value of 0 indicates success.
+ */
+typedef void (*hb_client_prefetch_cb) (
+      int32_t err,
+      hb_client_t client,
+      void *extra);
+
 /**
  * Mutation call back typedef
  *
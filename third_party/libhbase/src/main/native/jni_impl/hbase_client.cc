@@ -20,6 +20,7 @@
 #include <jni.h>
 #include <stdint.h>
 #include <errno.h>
+#include <string.h>
 
 #include "hbase_client.h"
 
@@ -207,6 +208,27 @@ hb_client_flush(
       Flush(cb, extra).GetCode();
 }
 
+/**
+ * Locates the first region of 'table' and caches its location in the client.
+ * The callback is invoked once it has been located.
+ */
+HBASE_API int32_t
+hb_client_prefetch_regions(
+    hb_client_t client,
+    const char *table,
+    hb_client_prefetch_cb cb,
+    void *extra) {
+  RETURN_IF_INVALID_PARAM((client == NULL),
+      Msgs::ERR_CLIENT_NULL);
+  RETURN_IF_INVALID_PARAM((table == NULL),
+      Msgs::ERR_TBL_NULL);
+  RETURN_IF_INVALID_PARAM((cb == NULL),
+      Msgs::ERR_CALLBACK_NULL);
+
+  return reinterpret_cast<HBaseClient*>(client)->
+      PrefetchRegions(table, cb, extra).GetCode();
+}
+
 /**
  * Cleans up hb_client_t handle and release any held resources.
  * The callback is called after the connections are closed, but just before the
@@ -242,9 +264,7 @@ HBaseClient::Init(
     JNIEnv *current_env) {
   JNI_GET_ENV(current_env);
   JniResult result = JniHelper::NewObject(
-      env, CLASS_CLIENT_PROXY,
-      JMETHOD1(JPARAM(HADOOP_CONF), "V"),
-      conf->GetConf());
+      env, METHOD_CLIENT_NEW, conf->GetConf());
   if (result.ok()) {
     jobject_ = env->NewGlobalRef(result.GetObject());
   }
@@ -259,8 +279,8 @@ HBaseClient::SendMutation(
     JNIEnv *current_env) {
   JNI_GET_ENV(current_env);
   JniResult result = JniHelper::InvokeMethod(
-      env, jobject_, CLASS_CLIENT_PROXY, "sendMutation",
-      "(L"CLASS_MUTATION_PROXY";JJJJ)V", mutation->JObject(),
+      env, jobject_, METHOD_CLIENT_SEND_MUTATION,
+      mutation->JObject(),
       (jlong) cb, (jlong) this, (jlong) mutation, (jlong) extra);
   return Status::Success;
 }
@@ -273,8 +293,8 @@ HBaseClient::SendGet(
     JNIEnv* current_env) {
   JNI_GET_ENV(current_env);
   JniResult result = JniHelper::InvokeMethod(
-      env, jobject_, CLASS_CLIENT_PROXY, "sendGet",
-      "(L"CLASS_GET_PROXY";JJJJ)V", get->JObject(),
+      env, jobject_, METHOD_CLIENT_SEND_GET,
+      get->JObject(),
       (jlong) cb, (jlong) this, (jlong) get, (jlong) extra);
   return Status::Success;
 }
@@ -286,11 +306,28 @@ HBaseClient::Flush(
     JNIEnv* current_env) {
   JNI_GET_ENV(current_env);
   JniResult result = JniHelper::InvokeMethod(
-      env, jobject_, CLASS_CLIENT_PROXY, "flush", "(JJJ)V",
+      env, jobject_, METHOD_CLIENT_FLUSH,
       (jlong) cb, (jlong) this, (jlong) extra);
   return Status::Success;
 }
 
+Status
+HBaseClient::PrefetchRegions(
+    const char *table,
+    hb_client_prefetch_cb cb,
+    void *extra,
+    JNIEnv *current_env) {
+  JNI_GET_ENV(current_env);
+  JniResult tableName = JniHelper::CreateJavaByteArray(
+      env, (const byte_t *) table, 0, strlen(table));
+  RETURN_IF_ERROR(tableName);
+
+  // completes through the flush callback, which has the same signature
+  return JniHelper::InvokeMethod(
+      env, jobject_, METHOD_CLIENT_PREFETCH_REGIONS,
+      tableName.GetObject(), (jlong) cb, (jlong) this, (jlong) extra);
+}
+
 Status
 HBaseClient::Close(
     hb_client_disconnection_cb cb,
@@ -300,8 +337,8 @@ HBaseClient::Close(
   if (jobject_ != NULL) {
     JNI_GET_ENV(current_env);
     JniResult result = JniHelper::InvokeMethod(
-        env, jobject_, CLASS_CLIENT_PROXY, "close",
-        "(JJJ)V", (jlong) cb, (jlong) this, (jlong) extra);
+        env, jobject_, METHOD_CLIENT_CLOSE,
+        (jlong) cb, (jlong) this, (jlong) extra);
     env->DeleteGlobalRef(jobject_);
     jobject_ = NULL;
   }
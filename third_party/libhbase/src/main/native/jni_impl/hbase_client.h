@@ -42,6 +42,9 @@ public:
 
   Status Close(hb_client_disconnection_cb cb, void *extra, JNIEnv *current_env=NULL);
 
+  Status PrefetchRegions(const char *table, hb_client_prefetch_cb cb, void *extra,
+      JNIEnv *current_env=NULL);
+
   Status SendMutation(Mutation *mutation, hb_mutation_cb cb, void *extra, JNIEnv *current_env=NULL);
 
   Status SendGet(Get *get, hb_mutation_cb cb, void *extra, JNIEnv *current_env=NULL);
@@ -48,7 +48,7 @@ hb_delete_create(
   *delete_ptr = NULL;
   Delete *del = new Delete();
   Status status = del->Init(
-      CLASS_DELETE_PROXY, rowkey, rowkey_len);
+      METHOD_DELETE_NEW, rowkey, rowkey_len);
   if (UNLIKELY(!status.ok())) {
     delete del;
     return status.GetCode();
@@ -46,14 +46,17 @@ hb_get_create(
       Msgs::ERR_GETPTR_NULL);
 
   *get_ptr = NULL;
-  Get *get = new Get();
+  Get *get = ObjectPool<Get>::Take();
   if (get == NULL) {
-    return ENOMEM;
+    get = new Get();
+    if (get == NULL) {
+      return ENOMEM;
+    }
   }
   Status status = get->Init(
-      CLASS_GET_PROXY, rowkey, rowkey_len);
+      METHOD_GET_NEW, rowkey, rowkey_len);
   if (UNLIKELY(!status.ok())) {
-    delete get;
+    get->Recycle();
     return status.GetCode();
   }
   *get_ptr = reinterpret_cast<hb_get_t> (get);
@@ -183,12 +186,18 @@ hb_get_destroy(hb_get_t get) {
   RETURN_IF_INVALID_PARAM((get == NULL),
       Msgs::ERR_GET_NULL);
 
-  delete reinterpret_cast<Get *>(get);
+  reinterpret_cast<Get *>(get)->Recycle();
   return 0;
 }
 
 } /* extern "C" */
 
+void
+Get::Recycle() {
+  Destroy();
+  ObjectPool<Get>::Give(this);
+}
+
 Status
 Get::AddColumn(
     const byte_t *f,
@@ -208,8 +217,8 @@ Get::AddColumn(
   }
 
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_GET_PROXY, "addColumn",
-      "([B[B)L"CLASS_GET_PROXY";", family.GetObject(), qualifier);
+      env, jobject_, METHOD_GET_ADD_COLUMN,
+      family.GetObject(), qualifier);
 }
 
 Status
@@ -218,8 +227,7 @@ Get::SetNumVersions(
     JNIEnv *current_env) {
   JNI_GET_ENV(current_env);
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_GET_PROXY, "setMaxVersions",
-      JMETHOD1("I", JPARAM(CLASS_GET_PROXY)), numVersions);
+      env, jobject_, METHOD_GET_SET_MAX_VERSIONS, numVersions);
 }
 
 Status
@@ -229,8 +237,7 @@ Get::SetFilter(
   JNI_GET_ENV(current_env);
   jstring filterString = env->NewStringUTF(filter);
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_GET_PROXY, "setFilter",
-      JMETHOD1(JPARAM(JAVA_STRING), JPARAM(CLASS_GET_PROXY)), filterString);
+      env, jobject_, METHOD_GET_SET_FILTER, filterString);
 }
 
 } /* namespace hbase */
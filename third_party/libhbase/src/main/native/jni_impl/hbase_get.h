@@ -25,15 +25,22 @@
 #include "hbase_row.h"
 #include "hbase_status.h"
 #include "jnihelper.h"
+#include "object_pool.h"
 
 namespace hbase {
 
 class Get : public Row {
 public:
-  Get() {}
+  Get() : nextFree_(NULL) {}
 
   ~Get() {}
 
+  /**
+   * Releases the Java object and returns this shell to the pool, from
+   * which hb_get_create() takes it again.
+   */
+  void Recycle();
+
   Status AddColumn(const byte_t *family, const size_t familyLen,
       const byte_t *qualifier, const size_t qualifierLen, JNIEnv *current_env=NULL);
 
@@ -42,6 +49,11 @@ public:
   Status SetFilter(const char *filter, JNIEnv *current_env=NULL);
 
   friend class HTable;
+
+private:
+  Get *nextFree_;
+
+  friend class ObjectPool<Get>;
 };
 
 } /* namespace hbase */
@@ -0,0 +1,121 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#line 19 "hbase_increment.cc" // ensures short filename in logs.
+
+#include <jni.h>
+#include <errno.h>
+
+#include <hbase/mutations.h>
+
+#include "hbase_increment.h"
+
+#include "hbase_macros.h"
+#include "hbase_msgs.h"
+#include "jnihelper.h"
+
+namespace hbase {
+
+extern "C" {
+
+/**
+ * Creates a structure for increment operation and return its handle.
+ */
+HBASE_API int32_t
+hb_increment_create(
+    const byte_t *rowkey,
+    const size_t rowkey_len,
+    hb_increment_t *increment_ptr) {
+  RETURN_IF_INVALID_PARAM((rowkey == NULL),
+      Msgs::ERR_KEY_NULL);
+  RETURN_IF_INVALID_PARAM((rowkey_len <= 0),
+      Msgs::ERR_KEY_LEN, rowkey_len);
+  RETURN_IF_INVALID_PARAM((increment_ptr == NULL),
+      Msgs::ERR_INCRPTR_NULL);
+
+  *increment_ptr = NULL;
+  Increment *incr = new Increment();
+  Status status = incr->Init(
+      METHOD_INCREMENT_NEW, rowkey, rowkey_len);
+  if (UNLIKELY(!status.ok())) {
+    delete incr;
+    return status.GetCode();
+  }
+  *increment_ptr = reinterpret_cast<hb_increment_t> (incr);
+  return 0;
+}
+
+/**
+ * Sets the column to increment and the amount to add to it. Only the
+ * family and qualifier of 'cell' are used.
+ */
+HBASE_API int32_t
+hb_increment_add_column(
+    hb_increment_t incr,
+    const hb_cell_t *cell,
+    const int64_t amount) {
+  RETURN_IF_INVALID_PARAM((incr == NULL),
+      Msgs::ERR_INCR_NULL);
+  RETURN_IF_INVALID_PARAM((cell == NULL),
+      Msgs::ERR_CELLPTR_NULL);
+  RETURN_IF_INVALID_PARAM((cell->family == NULL),
+      Msgs::ERR_FAMILY_NULL);
+  RETURN_IF_INVALID_PARAM((cell->family_len <= 0),
+      Msgs::ERR_FAMILY_LEN, cell->family_len);
+  RETURN_IF_INVALID_PARAM((cell->qualifier == NULL),
+      Msgs::ERR_QUAL_NULL);
+  RETURN_IF_INVALID_PARAM((cell->qualifier_len <= 0),
+      Msgs::ERR_QUAL_LEN, cell->qualifier_len);
+
+  return reinterpret_cast<Increment *>(incr)->
+      SetColumn(cell->family, cell->family_len,
+          cell->qualifier, cell->qualifier_len, amount).GetCode();
+}
+
+} /* extern "C" */
+
+Status
+Increment::SetColumn(
+    const byte_t *family,
+    const size_t family_len,
+    const byte_t *qualifier,
+    const size_t qualifier_len,
+    const int64_t amount,
+    JNIEnv *current_env) {
+  // asynchbase increments a single column per request
+  if (hasColumn_) {
+    return ENOTSUP;
+  }
+
+  JNI_GET_ENV(current_env);
+  JniResult jFamily = JniHelper::CreateJavaByteArray(
+      env, family, 0, family_len);
+  RETURN_IF_ERROR(jFamily);
+  JniResult jQualifier = JniHelper::CreateJavaByteArray(
+      env, qualifier, 0, qualifier_len);
+  RETURN_IF_ERROR(jQualifier);
+
+  Status status = JniHelper::InvokeMethod(
+      env, jobject_, METHOD_INCREMENT_SET_COLUMN,
+      jFamily.GetObject(), jQualifier.GetObject(), (jlong) amount);
+  if (status.ok()) {
+    hasColumn_ = true;
+  }
+  return status;
+}
+
+} /* namespace hbase */
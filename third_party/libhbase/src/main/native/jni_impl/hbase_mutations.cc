@@ -103,6 +103,24 @@ hb_mutation_set_bufferable(
       SetBufferable(bufferable).GetCode();
 }
 
+/**
+ * Optional (default = false). When set, the values of cells subsequently
+ * added to this mutation are handed to the JVM as direct ByteBuffers that
+ * wrap the caller's memory, instead of being copied into Java byte arrays
+ * through JNI. The value buffers must stay valid and unmodified until the
+ * hb_put_add_*() call that passed them returns.
+ */
+HBASE_API int32_t
+hb_mutation_set_direct_buffers(
+    hb_mutation_t mutation,
+    const bool direct_buffers) {
+  RETURN_IF_INVALID_PARAM((mutation == NULL),
+      Msgs::ERR_MUTATION_NULL);
+
+  reinterpret_cast<Mutation *>(mutation)->SetDirectBuffers(direct_buffers);
+  return 0;
+}
+
 /**
  * Frees up any resource held by the mutation structure.
  */
@@ -123,8 +141,7 @@ Mutation::SetDurability(
     JNIEnv *current_env) {
   JNI_GET_ENV(current_env);
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_MUTATION_PROXY,
-      "setDurability", "(I)V", (int32_t)durability);
+      env, jobject_, METHOD_MUTATION_SET_DURABILITY, (int32_t)durability);
 }
 
 Status inline
@@ -140,8 +157,7 @@ BufferableRpc::SetBufferable(
     JNIEnv *current_env) {
   JNI_GET_ENV(current_env);
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_MUTATION_PROXY,
-      "setBufferable", "(Z)V", (jboolean)bufferable);
+      env, jobject_, METHOD_MUTATION_SET_BUFFERABLE, (jboolean)bufferable);
 }
 
 Status
@@ -167,6 +183,17 @@ Mutation::AddColumn(
   }
 
   jobject valueObj = NULL;
+  if (v && directBuffers_) {
+    // NULL if the JVM does not support direct buffer access
+    valueObj = env->NewDirectByteBuffer((void *)v, (jlong)vLen);
+    if (LIKELY(valueObj != NULL)) {
+      return JniHelper::InvokeMethod(
+          env, jobject_, METHOD_MUTATION_ADD_COLUMN_BUFFER,
+          family.GetObject(), qualObj, (jlong)ts, valueObj);
+    }
+    env->ExceptionClear();
+  }
+
   if (v) {
     JniResult value = JniHelper::CreateJavaByteArray(env, v, 0, vLen);
     RETURN_IF_ERROR(value);
@@ -174,8 +201,7 @@ Mutation::AddColumn(
   }
 
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_MUTATION_PROXY,
-      "addColumn", "([B[BJ[B)L"CLASS_MUTATION_PROXY";",
+      env, jobject_, METHOD_MUTATION_ADD_COLUMN,
       family.GetObject(), qualObj, (jlong)ts, valueObj);
 }
 
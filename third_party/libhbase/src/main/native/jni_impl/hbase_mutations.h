@@ -38,17 +38,23 @@ public:
 
   virtual Status SetBufferable(const bool bufferable, JNIEnv *current_env=NULL);
 
+  void SetDirectBuffers(const bool directBuffers) { directBuffers_ = directBuffers; }
+
   friend class HTable;
 
 protected:
-  Mutation(bool isIncrement) : isIncrement_(isIncrement) {}
+  Mutation(bool isIncrement)
+  : isIncrement_(isIncrement),
+    directBuffers_(false) {}
 
   bool isIncrement_;
+
+  bool directBuffers_;
 };
 
 class BufferableRpc : public Mutation {
 protected:
-  BufferableRpc() : Mutation(false) { }
+  BufferableRpc(bool isIncrement=false) : Mutation(isIncrement) { }
 
 public:
   Status SetBufferable(const bool bufferable, JNIEnv *current_env=NULL);
@@ -51,7 +51,7 @@ hb_put_create(
   *put_ptr = NULL;
   Put *put = new Put();
   Status status = put->Init(
-      CLASS_PUT_PROXY, rowkey, rowkey_len);
+      METHOD_PUT_NEW, rowkey, rowkey_len);
   if (UNLIKELY(!status.ok())) {
     delete put;
     return status.GetCode();
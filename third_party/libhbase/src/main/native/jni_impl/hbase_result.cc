@@ -19,6 +19,9 @@
 
 #include <jni.h>
 #include <errno.h>
+#include <string.h>
+
+#include <new>
 
 #include "hbase_macros.h"
 #include "hbase_msgs.h"
@@ -37,7 +40,7 @@ hb_result_destroy(hb_result_t r) {
   RETURN_IF_INVALID_PARAM((r == NULL),
       Msgs::ERR_RESULT_NULL);
 
-  delete reinterpret_cast<Result *>(r);
+  reinterpret_cast<Result *>(r)->Recycle();
   return 0;
 }
 
@@ -201,82 +204,147 @@ Result::From(
     JNIEnv *env) {
   if (result) {
     // TODO: may be wrap exception if not null
-    return (hb_result_t) new Result(env->NewGlobalRef(result));
+    Result *r = ObjectPool<Result>::Take();
+    if (r == NULL) {
+      r = new Result();
+    }
+    r->jobject_ = env->NewGlobalRef(result);
+    r->Init(env);
+    return (hb_result_t) r;
   }
   return NULL;
 }
 
-void
-Result::FreeCell(hb_cell_t *cell_ptr) {
-  if (cell_ptr) {
-    if (cell_ptr->family) {
-      delete[] cell_ptr->family;
-      cell_ptr->family = NULL;
-    }
-    if (cell_ptr->qualifier) {
-      delete[] cell_ptr->qualifier;
-      cell_ptr->qualifier = NULL;
-    }
-    if (cell_ptr->value) {
-      delete[] cell_ptr->value;
-      cell_ptr->value = NULL;
-    }
-  }
+/** largest buffer a recycled result keeps for the next one */
+static const size_t MAX_RETAINED_BUFFER = 64 * 1024;
+
+/** family, qualifier and value lengths followed by the timestamp */
+static const size_t PACKED_CELL_HEADER_SIZE = 4 + 4 + 4 + 8;
+
+static inline uint32_t
+ReadInt32(const byte_t *buf) {
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16)
+       | ((uint32_t)buf[2] << 8)  |  (uint32_t)buf[3];
 }
 
-Result::Result(jobject resultProxy)
-:   JniObject(resultProxy),
-    tableName_(NULL),
+static inline int64_t
+ReadInt64(const byte_t *buf) {
+  return (int64_t)(((uint64_t)ReadInt32(buf) << 32) | ReadInt32(buf + 4));
+}
+
+Result::Result()
+:   tableName_(NULL),
     tableNameLen_(0),
     rowKey_(NULL),
     rowKeyLen_(0),
+    buffer_(NULL),
+    bufferCapacity_(0),
+    cellBuffer_(NULL),
+    cellBufferCapacity_(0),
     cells_(NULL),
-    cellCount_(0) {
-  Init();
+    cellCount_(0),
+    nextFree_(NULL) {
 }
 
 Result::~Result() {
-  if (tableName_ != NULL) {
-    delete[] tableName_;
-    tableName_ = NULL;
+  delete[] buffer_;
+  buffer_ = NULL;
+  delete[] cellBuffer_;
+  cellBuffer_ = NULL;
+  cells_ = NULL;
+}
+
+void
+Result::Recycle() {
+  Destroy();
+  tableName_ = NULL;
+  tableNameLen_ = 0;
+  rowKey_ = NULL;
+  rowKeyLen_ = 0;
+  cells_ = NULL;
+  cellCount_ = 0;
+  if (bufferCapacity_ > MAX_RETAINED_BUFFER) {
+    delete[] buffer_;
+    buffer_ = NULL;
+    bufferCapacity_ = 0;
   }
+  if (cellBufferCapacity_ > MAX_RETAINED_BUFFER) {
+    delete[] cellBuffer_;
+    cellBuffer_ = NULL;
+    cellBufferCapacity_ = 0;
+  }
+  ObjectPool<Result>::Give(this);
+}
 
-  if (rowKey_ != NULL) {
-    delete[] rowKey_;
-    rowKey_ = NULL;
+/**
+ * Grows '*buffer' to at least 'size' bytes. Its contents are not kept, so
+ * it must be called before anything is written to it or handed out.
+ */
+Status
+Result::Reserve(char **buffer, size_t *capacity, size_t size) {
+  if (size <= *capacity) {
+    return Status::Success;
   }
 
-  if (cells_ != NULL) {
-    for (size_t i = 0; i < cellCount_; ++i) {
-      if (cells_[i]) {
-        FreeCell(cells_[i]);
-        delete cells_[i];
-      }
-    }
-    delete[] cells_;
-    cells_ = NULL;
+  size_t newCapacity = *capacity ? *capacity : 256;
+  while (newCapacity < size) {
+    newCapacity *= 2;
+  }
+  char *newBuffer = new (std::nothrow) char[newCapacity];
+  if (newBuffer == NULL) {
+    return Status::ENoMem;
   }
+  delete[] *buffer;
+  *buffer = newBuffer;
+  *capacity = newCapacity;
+  return Status::Success;
 }
 
+/**
+ * Reads the table name and the row key into the buffer, without the
+ * allocation per field that JniHelper::CreateByteArray() makes.
+ */
 Status
 Result::Init(JNIEnv* current_env) {
   JNI_GET_ENV(current_env);
 
   JniResult result = JniHelper::InvokeMethod(
-      env, jobject_, CLASS_RESULT_PROXY, "getTable", "()[B");
+      env, jobject_, METHOD_RESULT_GET_TABLE);
   RETURN_IF_ERROR(result);
-  RETURN_IF_ERROR(JniHelper::CreateByteArray(
-      env, result.GetObject(),
-      (byte_t **)&tableName_, &tableNameLen_));
+  jbyteArray table = static_cast<jbyteArray>(result.GetObject());
 
   JniResult row = JniHelper::InvokeMethod(
-      env, jobject_, CLASS_RESULT_PROXY, "getRowKey", "()[B");
-  RETURN_IF_ERROR(row);
-  RETURN_IF_ERROR(JniHelper::CreateByteArray(
-      env, row.GetObject(), &rowKey_, &rowKeyLen_));
+      env, jobject_, METHOD_RESULT_GET_ROW_KEY);
+  jbyteArray rowKey = row.ok() ? static_cast<jbyteArray>(row.GetObject()) : NULL;
+
+  const size_t tableLen = table ? (size_t) env->GetArrayLength(table) : 0;
+  const size_t rowKeyLen = rowKey ? (size_t) env->GetArrayLength(rowKey) : 0;
+  Status status = row.ok()
+      ? Reserve(&buffer_, &bufferCapacity_, tableLen + rowKeyLen) : row;
+
+  if (status.ok() && table) {
+    tableName_ = buffer_;
+    tableNameLen_ = tableLen;
+    env->GetByteArrayRegion(table, 0, tableLen, (jbyte *)tableName_);
+  }
+  if (status.ok() && rowKey) {
+    rowKey_ = reinterpret_cast<byte_t *>(buffer_ + tableLen);
+    rowKeyLen_ = rowKeyLen;
+    env->GetByteArrayRegion(rowKey, 0, rowKeyLen, (jbyte *)rowKey_);
+  }
+
+  // a scanner callback converts a whole batch on a thread which does not
+  // return to Java in between, so its local references would pile up
+  if (table) {
+    env->DeleteLocalRef(table);
+  }
+  if (rowKey) {
+    env->DeleteLocalRef(rowKey);
+  }
+  RETURN_IF_ERROR(status);
 
   JniResult count = JniHelper::InvokeMethod(
-      env, jobject_, CLASS_RESULT_PROXY, "getCellCount", "()I");
+      env, jobject_, METHOD_RESULT_GET_CELL_COUNT);
   cellCount_ = (count.ok() ? count.GetValue().i : -1);
 
   return Status::Success;
@@ -327,25 +395,21 @@ Result::GetCell(
   if (!cellCount_) {
     return Status::ENoEntry;
   }
-  JNI_GET_ENV(current_env);
-
-  JniResult family = JniHelper::CreateJavaByteArray(env, f, 0, f_len);
-  RETURN_IF_ERROR(family);
-
-  JniResult qualifier = JniHelper::CreateJavaByteArray(env, q, 0, q_len);
-  RETURN_IF_ERROR(qualifier);
-
-  JniResult result = JniHelper::InvokeMethod(
-      env, jobject_, CLASS_RESULT_PROXY, "indexOf",
-      "([B[B)I", family.GetObject(), qualifier.GetObject());
-  RETURN_IF_ERROR(result);
-
-  int32_t cellIndex = result.GetValue().i;
-  if (cellIndex < 0) {
-    return Status::ENoEntry;
+  RETURN_IF_ERROR(EnsureCells(current_env));
+
+  // cells are sorted by family, qualifier and descending timestamp,
+  // so the first match is the most recent version.
+  for (size_t i = 0; i < cellCount_; ++i) {
+    const hb_cell_t *cell = cells_[i];
+    if (cell->family_len == f_len && cell->qualifier_len == q_len
+        && memcmp(cell->family, f, f_len) == 0
+        && memcmp(cell->qualifier, q, q_len) == 0) {
+      *(const_cast<hb_cell_t **>(cell_ptr)) = cells_[i];
+      return Status::Success;
+    }
   }
 
-  return GetCellAt(cellIndex, cell_ptr, env);
+  return Status::ENoEntry;
 }
 
 /**
@@ -360,37 +424,7 @@ Result::GetCellAt(
     return Status::ERange;
   }
 
-  EnsureCells();
-  if (!cells_[index]) {
-    hb_cell_t *cell = cells_[index] = new hb_cell_t();
-    cell->row = rowKey_;
-    cell->row_len = rowKeyLen_;
-
-    JNI_GET_ENV(current_env);
-
-    JniResult result = JniHelper::InvokeMethod(
-        env, jobject_, CLASS_RESULT_PROXY, "getFamily", "(I)[B", index);
-    RETURN_IF_ERROR(result);
-    RETURN_IF_ERROR(JniHelper::CreateByteArray(
-        env, result.GetObject(), &cell->family, &cell->family_len));
-
-    result = JniHelper::InvokeMethod(
-        env, jobject_, CLASS_RESULT_PROXY, "getQualifier", "(I)[B", index);
-    RETURN_IF_ERROR(result);
-    RETURN_IF_ERROR(JniHelper::CreateByteArray(
-        env, result.GetObject(), &cell->qualifier, &cell->qualifier_len));
-
-    result = JniHelper::InvokeMethod(
-        env, jobject_, CLASS_RESULT_PROXY, "getValue", "(I)[B", index);
-    RETURN_IF_ERROR(result);
-    RETURN_IF_ERROR(JniHelper::CreateByteArray(
-        env, result.GetObject(), &cell->value, &cell->value_len));
-
-    result = JniHelper::InvokeMethod(
-        env, jobject_, CLASS_RESULT_PROXY, "getTS", "(I)J", index);
-    RETURN_IF_ERROR(result);
-    cell->ts = result.GetValue().j;
-  }
+  RETURN_IF_ERROR(EnsureCells(current_env));
 
   if (cell_ptr) {
     *(const_cast<hb_cell_t **>(cell_ptr)) = cells_[index];
@@ -404,27 +438,95 @@ Result::GetCells(
     const hb_cell_t ***cell_ptr,
     size_t *num_cells,
     JNIEnv *current_env) {
-  Status status = Status::Success;
-  if (cellCount_) {
-    JNI_GET_ENV(current_env);
-    EnsureCells();
-    for (size_t i = 0; i < cellCount_; ++i) {
-      if (!cells_[i]) {
-        GetCellAt(i, NULL, env);
-      }
-    }
-  }
+  Status status = EnsureCells(current_env);
 
   *(const_cast<hb_cell_t ***>(cell_ptr)) = cells_;
-  *num_cells = cellCount_;
+  *num_cells = status.ok() ? cellCount_ : 0;
+  return status;
+}
+
+/**
+ * Materializes every cell of the result with a single JNI call. The packed
+ * cells are copied into the cell buffer and the hb_cell_t structures point
+ * into it, so a recycled result reads its cells without allocating once
+ * its cell buffer is large enough.
+ */
+Status
+Result::EnsureCells(JNIEnv *current_env) {
+  if (cells_ != NULL || cellCount_ == 0) {
+    return Status::Success;
+  }
+
+  JNI_GET_ENV(current_env);
+  JniResult result = JniHelper::InvokeMethod(
+      env, jobject_, METHOD_RESULT_GET_PACKED_CELLS);
+  RETURN_IF_ERROR(result);
+
+  jbyteArray packed = (jbyteArray) result.GetObject();
+  if (UNLIKELY(packed == NULL)) {
+    HBASE_LOG_ERROR("No packed cells for %zu cells.", cellCount_);
+    return Status::HBaseInternalError;
+  }
+
+  Status status = CopyCells(env, packed);
+  env->DeleteLocalRef(packed);
   return status;
 }
 
-inline void
-Result::EnsureCells() {
-  if (cellCount_ > 0 && cells_ == NULL) {
-    cells_ = new hb_cell_t*[cellCount_]();
+/**
+ * Lays out the cells of 'packed', the result of getPackedCells(), in the
+ * cell buffer.
+ */
+Status
+Result::CopyCells(JNIEnv *env, jbyteArray packed) {
+  const size_t packedLen = env->GetArrayLength(packed);
+  const size_t headerLen = cellCount_ * PACKED_CELL_HEADER_SIZE;
+  if (UNLIKELY(packedLen < headerLen)) {
+    HBASE_LOG_ERROR("Packed cells too short: %zu bytes for %zu cells.",
+        packedLen, cellCount_);
+    return Status::HBaseInternalError;
+  }
+
+  const size_t cellsOffset = cellCount_ * sizeof(hb_cell_t *);
+  const size_t dataOffset = cellsOffset + cellCount_ * sizeof(hb_cell_t);
+  RETURN_IF_ERROR(Reserve(&cellBuffer_, &cellBufferCapacity_,
+      dataOffset + packedLen));
+  char *arena = cellBuffer_;
+  env->GetByteArrayRegion(packed, 0, packedLen, (jbyte *)(arena + dataOffset));
+
+  hb_cell_t **cells = reinterpret_cast<hb_cell_t **>(arena);
+  hb_cell_t *cell = reinterpret_cast<hb_cell_t *>(arena + cellsOffset);
+  const byte_t *header = reinterpret_cast<byte_t *>(arena + dataOffset);
+  byte_t *data = reinterpret_cast<byte_t *>(arena + dataOffset + headerLen);
+  const byte_t *end = reinterpret_cast<byte_t *>(arena + dataOffset + packedLen);
+
+  for (size_t i = 0; i < cellCount_; ++i, ++cell) {
+    cell->row = rowKey_;
+    cell->row_len = rowKeyLen_;
+    cell->family_len = ReadInt32(header);
+    cell->qualifier_len = ReadInt32(header + 4);
+    cell->value_len = ReadInt32(header + 8);
+    cell->ts = ReadInt64(header + 12);
+    cell->private_ = NULL;
+    header += PACKED_CELL_HEADER_SIZE;
+
+    if (UNLIKELY((size_t)(end - data) < cell->family_len
+        + cell->qualifier_len + cell->value_len)) {
+      HBASE_LOG_ERROR("Packed cell %zu overruns the buffer.", i);
+      return Status::HBaseInternalError;
+    }
+    cell->family = data;
+    data += cell->family_len;
+    cell->qualifier = data;
+    data += cell->qualifier_len;
+    cell->value = data;
+    data += cell->value_len;
+
+    cells[i] = cell;
   }
+
+  cells_ = cells;
+  return Status::Success;
 }
 
 } /* namespace hbase */
@@ -24,6 +24,7 @@
 
 #include "hbase_status.h"
 #include "jnihelper.h"
+#include "object_pool.h"
 
 namespace hbase {
 
@@ -46,14 +47,22 @@ public:
 
   Status GetCells(const hb_cell_t ***cell_ptr, size_t *num_cells, JNIEnv *current_env=NULL);
 
+  /**
+   * Releases the Java object and returns this shell, with its buffer, to
+   * the pool from which From() takes it again.
+   */
+  void Recycle();
+
   static hb_result_t From(jthrowable jthr, jobject result, JNIEnv *env);
 
 protected:
-  Result(jobject resultProxy);
+  Result();
+
+  Status EnsureCells(JNIEnv *current_env=NULL);
 
-  void EnsureCells();
+  Status CopyCells(JNIEnv *env, jbyteArray packed);
 
-  static void FreeCell(hb_cell_t *cell_ptr);
+  static Status Reserve(char **buffer, size_t *capacity, size_t size);
 
 private:
   char      *tableName_;
@@ -62,8 +71,26 @@ private:
   byte_t    *rowKey_;
   size_t    rowKeyLen_;
 
+  /**
+   * Holds the table name and the row key. It is sized once in Init(), so
+   * the pointers handed out for them never move.
+   */
+  char      *buffer_;
+  size_t    bufferCapacity_;
+
+  /**
+   * Holds the cell pointers, the cells and the packed cell data they point
+   * into, once the cells are read. Both buffers outlive the result when the
+   * shell is recycled, unless they grew beyond MAX_RETAINED_BUFFER bytes.
+   */
+  char      *cellBuffer_;
+  size_t    cellBufferCapacity_;
   hb_cell_t **cells_;
   size_t    cellCount_;
+
+  Result    *nextFree_;
+
+  friend class ObjectPool<Result>;
 };
 
 } /* namespace hbase */
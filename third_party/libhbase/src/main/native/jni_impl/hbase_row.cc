@@ -29,7 +29,7 @@ namespace hbase {
 
 Status
 Row::Init(
-    const char *CLASS_NAME,
+    JniMethodId ctorId,
     const byte_t *rowKey,
     const size_t rowKeyLen,
     JNIEnv *current_env) {
@@ -38,7 +38,7 @@ Row::Init(
       env, rowKey, 0, rowKeyLen);
   RETURN_IF_ERROR(result);
   result = JniHelper::NewObject(
-      env, CLASS_NAME, "([B)V", result.GetObject());
+      env, ctorId, result.GetObject());
   if (result.ok()) {
     jobject_ = env->NewGlobalRef(result.GetObject());
   }
@@ -55,8 +55,7 @@ Row::SetRowKey(
       env, rowkey, 0, rowkey_len);
   RETURN_IF_ERROR(rowKey);
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_ROW_PROXY,
-      "setRow", "([B)V", rowKey.GetObject());
+      env, jobject_, METHOD_ROW_SET_ROW, rowKey.GetObject());
 }
 
 Status
@@ -69,8 +68,7 @@ Row::SetTable(
       env, (const byte_t *)table, 0, tableLen);
   RETURN_IF_ERROR(tableName);
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_ROW_PROXY,
-      "setTable", "([B)V", tableName.GetObject());
+      env, jobject_, METHOD_ROW_SET_TABLE, tableName.GetObject());
 }
 
 Status
@@ -79,7 +77,7 @@ Row::SetTS(
     JNIEnv *current_env) {
   JNI_GET_ENV(current_env);
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_ROW_PROXY, "setTS", "(I)V", ts);
+      env, jobject_, METHOD_ROW_SET_TS, ts);
 }
 
 } /* namespace hbase */
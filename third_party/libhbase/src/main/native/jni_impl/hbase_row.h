@@ -33,7 +33,7 @@ public:
 
   ~Row() {}
 
-  Status Init(const char *CLASS_NAME,
+  Status Init(JniMethodId ctorId,
       const byte_t *rowKey, const size_t rowKeyLen, JNIEnv *current_env=NULL);
 
   Status SetRowKey(const byte_t *rowKey, const size_t rowKeyLen, JNIEnv *current_env=NULL);
@@ -249,6 +249,28 @@ hb_scanner_set_num_max_rows(
       SetMaxNumRows(cache_size).GetCode();
 }
 
+/**
+ * Restricts the scanner to one column family, and to one qualifier of it
+ * unless 'qualifier' is NULL.
+ */
+HBASE_API int32_t
+hb_scanner_set_column(
+    hb_scanner_t scanner,
+    const byte_t *family,
+    const size_t family_len,
+    const byte_t *qualifier,
+    const size_t qualifier_len) {
+  RETURN_IF_INVALID_PARAM((scanner == NULL),
+      Msgs::ERR_SCANNER_NULL);
+  RETURN_IF_INVALID_PARAM((family == NULL),
+      Msgs::ERR_FAMILY_NULL);
+  RETURN_IF_INVALID_PARAM((family_len <= 0),
+      Msgs::ERR_FAMILY_LEN, family_len);
+
+  return reinterpret_cast<HScanner*>(scanner)->
+      SetColumn(family, family_len, qualifier, qualifier_len).GetCode();
+}
+
 } /* extern "C" */
 
 #define ERROR_IF_SCANNER_OPEN() \
@@ -264,9 +286,7 @@ HScanner::Init(
   JNI_GET_ENV(current_env);
 
   JniResult result = JniHelper::NewObject(
-      env, CLASS_SCANNER_PROXY,
-      JMETHOD1(JPARAM(CLASS_CLIENT_PROXY), "V"),
-      client->JObject());
+      env, METHOD_SCANNER_NEW, client->JObject());
   if (result.ok()) {
     jobject_ = env->NewGlobalRef(result.GetObject());
   }
@@ -282,7 +302,7 @@ HScanner::NextRows(
 
   is_open_ = true;
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_SCANNER_PROXY, "next", "(JJJ)V",
+      env, jobject_, METHOD_SCANNER_NEXT,
       (jlong) cb, (jlong) this, (jlong) extra).GetCode();
 }
 
@@ -294,7 +314,7 @@ HScanner::Close(
   if (jobject_ != NULL) {
     JNI_GET_ENV(current_env);
     JniResult result = JniHelper::InvokeMethod(
-        env, jobject_, CLASS_SCANNER_PROXY, "close", "(JJJ)V",
+        env, jobject_, METHOD_SCANNER_CLOSE,
         (jlong) cb, (jlong) this, (jlong) extra);
     env->DeleteGlobalRef(jobject_);
     jobject_ = NULL;
@@ -316,8 +336,7 @@ HScanner::SetTable(
   RETURN_IF_ERROR(tableName);
 
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_SCANNER_PROXY,
-      "setTable", "([B)V", tableName.GetObject());
+      env, jobject_, METHOD_SCANNER_SET_TABLE, tableName.GetObject());
 }
 
 Status
@@ -328,8 +347,7 @@ HScanner::SetMaxNumRows(
   JNI_GET_ENV(current_env);
 
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_SCANNER_PROXY,
-      "setMaxNumRows", "(I)V", (int32_t)cache_size);
+      env, jobject_, METHOD_SCANNER_SET_MAX_NUM_ROWS, (int32_t)cache_size);
 }
 
 Status
@@ -340,8 +358,7 @@ HScanner::SetNumVersions(
   JNI_GET_ENV(current_env);
 
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_SCANNER_PROXY,
-      "setNumVersions", "(I)V", (int32_t)num_versions);
+      env, jobject_, METHOD_SCANNER_SET_NUM_VERSIONS, (int32_t)num_versions);
 }
 
 Status
@@ -357,8 +374,7 @@ HScanner::SetStartRow(
   RETURN_IF_ERROR(startRow);
 
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_SCANNER_PROXY,
-      "setRow", "([B)V", startRow.GetObject());
+      env, jobject_, METHOD_SCANNER_SET_ROW, startRow.GetObject());
 }
 
 Status
@@ -374,8 +390,33 @@ HScanner::SetEndRow(
   RETURN_IF_ERROR(endRow);
 
   return JniHelper::InvokeMethod(
-      env, jobject_, CLASS_SCANNER_PROXY,
-      "setEndRow", "([B)V", endRow.GetObject());
+      env, jobject_, METHOD_SCANNER_SET_END_ROW, endRow.GetObject());
+}
+
+Status
+HScanner::SetColumn(
+    const byte_t *family,
+    const size_t family_len,
+    const byte_t *qualifier,
+    const size_t qualifier_len,
+    JNIEnv *current_env) {
+  ERROR_IF_SCANNER_OPEN();
+  JNI_GET_ENV(current_env);
+
+  JniResult jFamily = JniHelper::CreateJavaByteArray(
+      env, family, 0, family_len);
+  RETURN_IF_ERROR(jFamily);
+
+  jobject jQualifier = NULL;
+  if (qualifier != NULL) {
+    JniResult result = JniHelper::CreateJavaByteArray(
+        env, qualifier, 0, qualifier_len);
+    RETURN_IF_ERROR(result);
+    jQualifier = result.GetObject();
+  }
+
+  return JniHelper::InvokeMethod(
+      env, jobject_, METHOD_SCANNER_SET_COLUMN, jFamily.GetObject(), jQualifier);
 }
 
 } /* namespace hbase */
@@ -50,6 +50,9 @@ public:
 
   Status SetEndRow(const byte_t *start_row, const size_t start_row_len, JNIEnv *current_env=NULL);
 
+  Status SetColumn(const byte_t *family, const size_t family_len,
+      const byte_t *qualifier, const size_t qualifier_len, JNIEnv *current_env=NULL);
+
 private:
   bool is_open_;
 };
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 #ifdef __CYGWIN__
   #include <sys/cygwin.h>
 #endif
@@ -59,6 +60,7 @@ namespace hbase {
 #define JAVA_CLASSPATH "CLASSPATH"
 #define HBASE_LIB_DIR  "HBASE_LIB_DIR"
 #define HBASE_CONF_DIR "HBASE_CONF_DIR"
+#define CLASSPATH_CACHE "LIBHBASE_CLASSPATH_CACHE"
 
 static pthread_mutex_t hbaseHashMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t jvmMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -263,6 +265,101 @@ BuildHBaseClassPath(
   return hbaseClassPath;
 }
 
+/**
+ * The classpath is saved to the file named by LIBHBASE_CLASSPATH_CACHE, after
+ * a header naming what it was built from, so that a restart can skip the scan
+ * of HBASE_LIB_DIR. Adding or removing a jar changes the modification time of
+ * the directory, which invalidates the cache. The directories are named by
+ * their real paths, as the classpath is, so that repointing a symlink to
+ * another HBase install invalidates it too.
+ */
+static std::string
+ClassPathCacheHeader(
+    const std::string& hbaseConfDir,
+    const std::string& hbaseLibDir,
+    const std::string& jvmClassPath) {
+  struct stat libDirStat;
+  char mtime[32] = "";
+  std::string confPath = hbaseConfDir;
+  std::string libPath = hbaseLibDir;
+
+  char *absConfDir = hbaseConfDir.empty()
+      ? NULL : realpath(hbaseConfDir.c_str(), NULL);
+  if (absConfDir != NULL) {
+    confPath = absConfDir;
+    free(absConfDir);
+  }
+
+  char *absLibPath = hbaseLibDir.empty()
+      ? NULL : realpath(hbaseLibDir.c_str(), NULL);
+  if (absLibPath != NULL) {
+    libPath = absLibPath;
+    free(absLibPath);
+  }
+
+  if (!libPath.empty() && stat(libPath.c_str(), &libDirStat) == 0) {
+    snprintf(mtime, sizeof(mtime), "%ld", (long) libDirStat.st_mtime);
+  }
+
+  std::string header = "libhbase-classpath-2\n";
+  header.append(confPath).append("\n")
+      .append(libPath).append("\n")
+      .append(mtime).append("\n")
+      .append(jvmClassPath).append("\n");
+  return header;
+}
+
+static std::string
+ReadClassPathCache(
+    const std::string& cachePath,
+    const std::string& header) {
+  FILE *file = fopen(cachePath.c_str(), "r");
+  if (file == NULL) {
+    return HConstants::EMPTY_STRING;
+  }
+
+  std::string contents;
+  char buffer[PATH_BUFFER_SIZE];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.append(buffer, read);
+  }
+  fclose(file);
+
+  if (contents.compare(0, header.size(), header) != 0
+      || contents.size() == header.size()) {
+    HBASE_LOG_INFO("Classpath cache '%s' is stale.", cachePath.c_str());
+    return HConstants::EMPTY_STRING;
+  }
+
+  HBASE_LOG_DEBUG("Using the classpath cached in '%s'.", cachePath.c_str());
+  return contents.substr(header.size());
+}
+
+static void
+WriteClassPathCache(
+    const std::string& cachePath,
+    const std::string& header,
+    const std::string& classPath) {
+  // written aside and renamed, so a concurrent start never reads half of it
+  std::string tmpPath = cachePath + ".tmp";
+  FILE *file = fopen(tmpPath.c_str(), "w");
+  if (file == NULL) {
+    HBASE_LOG_WARN("Could not write classpath cache '%s'. %s",
+        tmpPath.c_str(), strerror(errno));
+    return;
+  }
+
+  bool written = fwrite(header.data(), 1, header.size(), file) == header.size()
+      && fwrite(classPath.data(), 1, classPath.size(), file) == classPath.size();
+  if (fclose(file) != 0 || !written
+      || rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+    HBASE_LOG_WARN("Could not write classpath cache '%s'. %s",
+        cachePath.c_str(), strerror(errno));
+    remove(tmpPath.c_str());
+  }
+}
+
 /**
  * Helper function to get the JNI class reference for the requested class.
  * This class caches the references and hence is faster than calling the JNI
@@ -535,41 +632,53 @@ JniHelper::InvokeMethodInternal(
     return JniResult(CheckException(env));
   }
 
-  JniResult result;
   const char *str = methSignature;
   while (*str != ')') str++;
   str++;
-  switch(*str) {
+
+  return CallMethodV(env, cls, method, *str, args, instObj);
+}
+
+JniResult
+JniHelper::CallMethodV(
+    JNIEnv *env,
+    jclass cls,
+    jmethodID method,
+    char returnType,
+    va_list args,
+    jobject instObj) {
+  JniResult result;
+  switch(returnType) {
   case JOBJECT:
   case JARRAYOBJECT:
-    result.value.l = (methType == INSTANCE)
+    result.value.l = (instObj != NULL)
         ? env->CallObjectMethodV(instObj, method, args)
         : env->CallStaticObjectMethodV(cls, method, args);
     break;
   case JVOID:
-    if (methType == INSTANCE) {
+    if (instObj != NULL) {
       env->CallVoidMethodV(instObj, method, args);
     } else {
       env->CallStaticVoidMethodV(cls, method, args);
     }
     break;
   case JBOOLEAN:
-    result.value.z = (methType == INSTANCE)
+    result.value.z = (instObj != NULL)
         ? env->CallBooleanMethodV(instObj, method, args)
         : env->CallStaticBooleanMethodV(cls, method, args);
     break;
   case JSHORT:
-    result.value.s = (methType == INSTANCE)
+    result.value.s = (instObj != NULL)
         ? env->CallShortMethodV(instObj, method, args)
         : env->CallStaticShortMethodV(cls, method, args);
     break;
   case JLONG:
-    result.value.j = (methType == INSTANCE)
+    result.value.j = (instObj != NULL)
         ? env->CallLongMethodV(instObj, method, args)
         : env->CallStaticLongMethodV(cls, method, args);
     break;
   case JINT:
-    result.value.i = (methType == INSTANCE)
+    result.value.i = (instObj != NULL)
         ? env->CallIntMethodV(instObj, method, args)
         : env->CallStaticIntMethodV(cls, method, args);
     break;
@@ -579,6 +688,91 @@ JniHelper::InvokeMethodInternal(
   return result;
 }
 
+/**
+ * A resolved entry of JNI_METHOD_TABLE. 'mid' is published last, so a
+ * non-NULL 'mid' implies 'cls' and 'returnType' are valid.
+ */
+typedef struct {
+  const char *className;
+  const char *methName;
+  const char *methSignature;
+  jclass      cls;
+  char        returnType;
+  jmethodID   mid;
+} JniMethod;
+
+static JniMethod s_methodTable[METHOD_COUNT] = {
+#define JNI_METHOD_ENTRY(id, cls, name, sig) { cls, name, sig, NULL, 0, NULL },
+  JNI_METHOD_TABLE(JNI_METHOD_ENTRY)
+#undef JNI_METHOD_ENTRY
+};
+
+static jmethodID
+ResolveMethod(
+    JNIEnv *env,
+    JniMethod *method) {
+  jclass cls = GetClassReference(env, method->className);
+  if (cls == NULL) {
+    return NULL;
+  }
+  jmethodID mid = GetClassMethodId(env, cls, method->className,
+      method->methName, method->methSignature, INSTANCE);
+  if (mid == NULL) {
+    return NULL;
+  }
+
+  const char *str = method->methSignature;
+  while (*str != ')') str++;
+  method->cls = cls;
+  method->returnType = *(str + 1);
+  __atomic_store_n(&method->mid, mid, __ATOMIC_RELEASE);
+  return mid;
+}
+
+static inline const JniMethod*
+GetMethod(
+    JNIEnv *env,
+    JniMethodId methodId) {
+  JniMethod *method = &s_methodTable[methodId];
+  if (UNLIKELY(__atomic_load_n(&method->mid, __ATOMIC_ACQUIRE) == NULL)) {
+    if (ResolveMethod(env, method) == NULL) {
+      return NULL;
+    }
+  }
+  return method;
+}
+
+/**
+ * Classes of the request path which native code never names. Their global
+ * references are kept in the class table, which also pins them.
+ */
+static const char *s_preloadedClasses[] = {
+  CLASS_CALLBACK_HANDLERS,
+  CLASS_GET_CALLBACK,
+  CLASS_MUTATION_CALLBACK,
+  CLASS_FLUSH_CALLBACK,
+  CLASS_SCANNER_CALLBACK,
+  ASYNC_HBASECLIENT,
+  ASYNC_GETREQUEST,
+  ASYNC_PUTREQUEST,
+  ASYNC_KEYVALUE,
+  ASYNC_SCANNER,
+  ASYNC_DEFERRED
+};
+
+void
+JniHelper::InitMethodTable(JNIEnv *env) {
+  for (int i = 0; i < METHOD_COUNT; ++i) {
+    if (ResolveMethod(env, &s_methodTable[i]) == NULL) {
+      env->ExceptionClear();
+    }
+  }
+
+  for (size_t i = 0; i < sizeof(s_preloadedClasses) / sizeof(s_preloadedClasses[0]); ++i) {
+    GetClassReference(env, s_preloadedClasses[i]);
+  }
+}
+
 /**
  * In-place URL decoding
  */
@@ -613,11 +807,44 @@ GetEnv(const char *name) {
 /** flag to record if the JVM was created by libhbase */
 static volatile bool s_VMCreated = false;
 
-JNIEnv*
-JniHelper::GetJNIEnv(void) {
+/** flag to record if the method table has been resolved */
+static volatile bool s_methodTableInited = false;
+
+/** the JVM, set once it has been created or found */
+static JavaVM *s_javaVM = NULL;
+
+/** the JNIEnv* of the current thread, once it is attached */
+static __thread JNIEnv *t_jniEnv = NULL;
+
+/**
+ * Set to the JavaVM* on threads attached by libhbase, so that they are
+ * detached when they exit.
+ */
+static pthread_key_t s_detachKey;
+
+static void
+DetachThreadAtExit(void *vm) {
+  static_cast<JavaVM *>(vm)->DetachCurrentThread();
+}
+
+/**
+ * Returns the JVM, creating it on the first call. The JVM mutex is only
+ * taken until the JVM exists.
+ */
+static JavaVM*
+GetJavaVM(void) {
+  JavaVM *cachedVM = __atomic_load_n(&s_javaVM, __ATOMIC_ACQUIRE);
+  if (LIKELY(cachedVM != NULL)) {
+    return cachedVM;
+  }
+
   // Only the first thread should create the JVM. The other threads should
   // just use the JVM created by the first thread.
   LOCK_JVM_MUTEX();
+  if (s_javaVM != NULL) {
+    UNLOCK_JVM_MUTEX();
+    return s_javaVM;
+  }
 
   jint noVMs = 0;
   const jsize vmBufLength = 1;
@@ -629,7 +856,7 @@ JniHelper::GetJNIEnv(void) {
     return NULL;
   }
 
-  JNIEnv *env = NULL;
+  JavaVM *vm = NULL;
   if (noVMs == 0) {
     //Get the environment variables for initializing the JVM
     std::string hbaseConfDir = GetEnv(HBASE_CONF_DIR);
@@ -648,11 +875,25 @@ JniHelper::GetJNIEnv(void) {
       return NULL;
     }
 
-    std::string optHBaseClassPath =
-        BuildHBaseClassPath(hbaseConfDir, hbaseLibDir, hbaseClassPath);
+    std::string cachePath = GetEnv(CLASSPATH_CACHE);
+    std::string cacheHeader;
+    std::string optHBaseClassPath;
+    if (!cachePath.empty()) {
+      cacheHeader = ClassPathCacheHeader(hbaseConfDir, hbaseLibDir, hbaseClassPath);
+      optHBaseClassPath = ReadClassPathCache(cachePath, cacheHeader);
+    }
+
     if (optHBaseClassPath.empty()) {
-      UNLOCK_JVM_MUTEX();
-      return NULL;
+      optHBaseClassPath =
+          BuildHBaseClassPath(hbaseConfDir, hbaseLibDir, hbaseClassPath);
+      if (optHBaseClassPath.empty()) {
+        UNLOCK_JVM_MUTEX();
+        return NULL;
+      }
+
+      if (!cachePath.empty()) {
+        WriteClassPathCache(cachePath, cacheHeader, optHBaseClassPath);
+      }
     }
 
     int noArgs = 1;
@@ -687,12 +928,12 @@ JniHelper::GetJNIEnv(void) {
     fflush(stdout);
     //Create the VM
     JavaVMInitArgs vm_args;
-    JavaVM *vm;
     vm_args.version = JNI_VERSION_1_2;
     vm_args.options = options;
     vm_args.nOptions = noArgs;
     vm_args.ignoreUnrecognized = 0;
 
+    JNIEnv *env = NULL;
     rv = JNI_CreateJavaVM(&vm, (void**)&env, (void*)&vm_args);
     if (rv != 0) {
       HBASE_LOG_FATAL("Call to JNI_CreateJavaVM failed "
@@ -707,17 +948,57 @@ JniHelper::GetJNIEnv(void) {
     if (!s_VMCreated) {
       HBASE_LOG_WARN("Found a JVM not created by libhbase.");
     }
-    //Attach this thread to the VM
-    JavaVM *vm = vmBuf[0];
+    vm = vmBuf[0];
+  }
+  rv = pthread_key_create(&s_detachKey, DetachThreadAtExit);
+  if (rv != 0) {
+    HBASE_LOG_FATAL("pthread_key_create failed with error: %d", rv);
+    UNLOCK_JVM_MUTEX();
+    return NULL;
+  }
+  __atomic_store_n(&s_javaVM, vm, __ATOMIC_RELEASE);
+  UNLOCK_JVM_MUTEX();
+
+  return vm;
+}
+
+JNIEnv*
+JniHelper::GetJNIEnv(void) {
+  JNIEnv *env = t_jniEnv;
+  if (LIKELY(env != NULL)) {
+    return env;
+  }
+
+  JavaVM *vm = GetJavaVM();
+  if (vm == NULL) {
+    return NULL;
+  }
+
+  // Threads created by the JVM, and the thread which created it, are
+  // already attached and must not be detached by us.
+  jint rv = vm->GetEnv((void**)&env, JNI_VERSION_1_2);
+  if (rv == JNI_EDETACHED) {
     rv = vm->AttachCurrentThread((void**)&env, (void *)NULL);
     if (rv != 0) {
       HBASE_LOG_FATAL("Call to AttachCurrentThread failed with error: %d", rv);
-      UNLOCK_JVM_MUTEX();
       return NULL;
     }
+    pthread_setspecific(s_detachKey, vm);
+  } else if (rv != JNI_OK) {
+    HBASE_LOG_FATAL("Call to GetEnv failed with error: %d", rv);
+    return NULL;
+  }
+
+  if (UNLIKELY(!s_methodTableInited)) {
+    LOCK_JVM_MUTEX();
+    if (!s_methodTableInited) {
+      InitMethodTable(env);
+      s_methodTableInited = true;
+    }
+    UNLOCK_JVM_MUTEX();
   }
-  UNLOCK_JVM_MUTEX();
 
+  t_jniEnv = env;
   return env;
 }
 
@@ -752,6 +1033,50 @@ JniHelper::InvokeMethodS(
   return result;
 }
 
+JniResult
+JniHelper::InvokeMethod(
+    JNIEnv *env,
+    jobject instObj,
+    JniMethodId methodId,
+    ...) {
+  const JniMethod *method = GetMethod(env, methodId);
+  if (UNLIKELY(method == NULL)) {
+    return JniResult(CheckException(env));
+  }
+
+  va_list args;
+  va_start(args, methodId);
+  JniResult result = CallMethodV(env, method->cls,
+      method->mid, method->returnType, args, instObj);
+  va_end(args);
+  return result;
+}
+
+JniResult
+JniHelper::NewObject(
+    JNIEnv *env,
+    JniMethodId ctorId,
+    ...) {
+  const JniMethod *ctor = GetMethod(env, ctorId);
+  if (UNLIKELY(ctor == NULL)) {
+    return JniResult(CheckException(env));
+  }
+
+  va_list args;
+  va_start(args, ctorId);
+  JniResult result;
+  result.value.l = env->NewObjectV(ctor->cls, ctor->mid, args);
+  va_end(args);
+  if (result.value.l == NULL) {
+    result.SetCode(CheckException(env));
+    HBASE_LOG_ERROR("Unable to create Java object with signature %s(%s)",
+                    ctor->className, ctor->methSignature);
+  }
+  result.SetCode(CheckException(env));
+
+  return result;
+}
+
 JniResult
 JniHelper::NewObject(
     JNIEnv *env,
@@ -53,19 +53,77 @@
 #define CLASS_ROW_PROXY         "org/apache/hadoop/hbase/jni/RowProxy"
 #define CLASS_RESULT_PROXY      "org/apache/hadoop/hbase/jni/ResultProxy"
 #define CLASS_DELETE_PROXY      "org/apache/hadoop/hbase/jni/DeleteProxy"
+#define CLASS_INCREMENT_PROXY   "org/apache/hadoop/hbase/jni/IncrementProxy"
 #define CLASS_MUTATION_PROXY    "org/apache/hadoop/hbase/jni/MutationProxy"
 #define CLASS_SCANNER_PROXY     "org/apache/hadoop/hbase/jni/ScannerProxy"
 #define CLASS_TABLE_PROXY       "org/apache/hadoop/hbase/jni/TableProxy"
 
+#define CLASS_CALLBACK_HANDLERS "org/apache/hadoop/hbase/jni/CallbackHandlers"
+#define CLASS_GET_CALLBACK      "org/apache/hadoop/hbase/jni/GetCallbackHandler"
+#define CLASS_MUTATION_CALLBACK "org/apache/hadoop/hbase/jni/MutationCallbackHandler"
+#define CLASS_FLUSH_CALLBACK    "org/apache/hadoop/hbase/jni/FlushCallbackHandler"
+#define CLASS_SCANNER_CALLBACK  "org/apache/hadoop/hbase/jni/ScannerNextCallback"
+
 #define ASYNC_REMOTEEXCEPTION   "org/hbase/async/RemoteException"
+#define ASYNC_HBASECLIENT       "org/hbase/async/HBaseClient"
+#define ASYNC_GETREQUEST        "org/hbase/async/GetRequest"
+#define ASYNC_PUTREQUEST        "org/hbase/async/PutRequest"
+#define ASYNC_KEYVALUE          "org/hbase/async/KeyValue"
+#define ASYNC_SCANNER           "org/hbase/async/Scanner"
+#define ASYNC_DEFERRED          "com/stumbleupon/async/Deferred"
 
 #define JAVA_OBJECT             "java/lang/Object"
 #define JAVA_THROWABLE          "java/lang/Throwable"
 #define JAVA_STACKTRACEELM      "java/lang/StackTraceElement"
 #define JAVA_STRING             "java/lang/String"
+#define JAVA_BYTEBUFFER         "java/nio/ByteBuffer"
 #define JAVA_LIST               "java/util/List"
 #define JAVA_ARRAYLIST          "java/util/ArrayList"
 
+/**
+ * Proxy methods invoked on the data path. Each one is resolved to a global
+ * class reference and a jmethodID once, when the JVM is first attached, so
+ * that invoking it through JniHelper::InvokeMethod(env, obj, JniMethodId, ...)
+ * needs no class lookup, locking or signature parsing.
+ *
+ * M(id, class, method, signature)
+ */
+#define JNI_METHOD_TABLE(M) \
+  M(CLIENT_NEW,             CLASS_CLIENT_PROXY,   "<init>",         JMETHOD1(JPARAM(HADOOP_CONF), "V")) \
+  M(CLIENT_SEND_MUTATION,   CLASS_CLIENT_PROXY,   "sendMutation",   "(" JPARAM(CLASS_MUTATION_PROXY) "JJJJ)V") \
+  M(CLIENT_SEND_GET,        CLASS_CLIENT_PROXY,   "sendGet",        "(" JPARAM(CLASS_GET_PROXY) "JJJJ)V") \
+  M(CLIENT_FLUSH,           CLASS_CLIENT_PROXY,   "flush",          "(JJJ)V") \
+  M(CLIENT_CLOSE,           CLASS_CLIENT_PROXY,   "close",          "(JJJ)V") \
+  M(CLIENT_PREFETCH_REGIONS, CLASS_CLIENT_PROXY,  "prefetchRegions", "([BJJJ)V") \
+  M(GET_NEW,                CLASS_GET_PROXY,      "<init>",         "([B)V") \
+  M(GET_ADD_COLUMN,         CLASS_GET_PROXY,      "addColumn",      "([B[B)" JPARAM(CLASS_GET_PROXY)) \
+  M(GET_SET_MAX_VERSIONS,   CLASS_GET_PROXY,      "setMaxVersions", JMETHOD1("I", JPARAM(CLASS_GET_PROXY))) \
+  M(GET_SET_FILTER,         CLASS_GET_PROXY,      "setFilter",      JMETHOD1(JPARAM(JAVA_STRING), JPARAM(CLASS_GET_PROXY))) \
+  M(PUT_NEW,                CLASS_PUT_PROXY,      "<init>",         "([B)V") \
+  M(DELETE_NEW,             CLASS_DELETE_PROXY,   "<init>",         "([B)V") \
+  M(INCREMENT_NEW,          CLASS_INCREMENT_PROXY, "<init>",        "([B)V") \
+  M(INCREMENT_SET_COLUMN,   CLASS_INCREMENT_PROXY, "setColumn",     "([B[BJ)V") \
+  M(ROW_SET_ROW,            CLASS_ROW_PROXY,      "setRow",         "([B)V") \
+  M(ROW_SET_TABLE,          CLASS_ROW_PROXY,      "setTable",       "([B)V") \
+  M(ROW_SET_TS,             CLASS_ROW_PROXY,      "setTS",          "(I)V") \
+  M(MUTATION_SET_DURABILITY, CLASS_MUTATION_PROXY, "setDurability", "(I)V") \
+  M(MUTATION_SET_BUFFERABLE, CLASS_MUTATION_PROXY, "setBufferable", "(Z)V") \
+  M(MUTATION_ADD_COLUMN,    CLASS_MUTATION_PROXY, "addColumn",      "([B[BJ[B)" JPARAM(CLASS_MUTATION_PROXY)) \
+  M(MUTATION_ADD_COLUMN_BUFFER, CLASS_MUTATION_PROXY, "addColumn",  "([B[BJ" JPARAM(JAVA_BYTEBUFFER) ")" JPARAM(CLASS_MUTATION_PROXY)) \
+  M(RESULT_GET_TABLE,       CLASS_RESULT_PROXY,   "getTable",       "()[B") \
+  M(RESULT_GET_ROW_KEY,     CLASS_RESULT_PROXY,   "getRowKey",      "()[B") \
+  M(RESULT_GET_CELL_COUNT,  CLASS_RESULT_PROXY,   "getCellCount",   "()I") \
+  M(RESULT_GET_PACKED_CELLS, CLASS_RESULT_PROXY,  "getPackedCells", "()[B") \
+  M(SCANNER_NEW,            CLASS_SCANNER_PROXY,  "<init>",         JMETHOD1(JPARAM(CLASS_CLIENT_PROXY), "V")) \
+  M(SCANNER_NEXT,           CLASS_SCANNER_PROXY,  "next",           "(JJJ)V") \
+  M(SCANNER_CLOSE,          CLASS_SCANNER_PROXY,  "close",          "(JJJ)V") \
+  M(SCANNER_SET_TABLE,      CLASS_SCANNER_PROXY,  "setTable",       "([B)V") \
+  M(SCANNER_SET_ROW,        CLASS_SCANNER_PROXY,  "setRow",         "([B)V") \
+  M(SCANNER_SET_END_ROW,    CLASS_SCANNER_PROXY,  "setEndRow",      "([B)V") \
+  M(SCANNER_SET_MAX_NUM_ROWS, CLASS_SCANNER_PROXY, "setMaxNumRows", "(I)V") \
+  M(SCANNER_SET_NUM_VERSIONS, CLASS_SCANNER_PROXY, "setNumVersions", "(I)V") \
+  M(SCANNER_SET_COLUMN,     CLASS_SCANNER_PROXY,  "setColumn",      "([B[B)V")
+
 /**
  * Retrieves a JNIEnv* unless one was provided.
  * Pushes a JNI local frame on the stack.
@@ -81,6 +139,13 @@
 
 namespace hbase {
 
+typedef enum {
+#define JNI_METHOD_ENUM(id, cls, name, sig) METHOD_##id,
+  JNI_METHOD_TABLE(JNI_METHOD_ENUM)
+#undef JNI_METHOD_ENUM
+  METHOD_COUNT
+} JniMethodId;
+
 class JniLocalFrame {
  public:
   JniLocalFrame(JNIEnv *env) : env_(env) {}
@@ -137,7 +202,9 @@ public:
 protected:
   jobject jobject_;
 
-private:
+  /**
+   * Releases the global reference, leaving the object ready for reuse.
+   */
   Status Destroy(JNIEnv *current_env=NULL);
 };
 
@@ -147,7 +214,9 @@ public:
   /**
    * GetJNIEnv: A helper function to get the JNIEnv* for the given thread.
    * If no JVM exists, then one will be created. JVM command line arguments
-   * are obtained from the LIBHDFS_OPTS environment variable.
+   * are obtained from the LIBHDFS_OPTS environment variable. The JNIEnv*
+   * is cached per thread, and threads attached here are detached when
+   * they exit.
    *
    * @param: None.
    * @returns The JNIEnv* corresponding to the thread.
@@ -169,6 +238,25 @@ public:
       const char *ctorSignature,
       ...);  /* the constructor arguments */
 
+  /**
+   * Invokes a constructor from the method table.
+   */
+  static JniResult NewObject(
+      JNIEnv *env,
+      JniMethodId ctorId,
+      ...);  /* the constructor arguments */
+
+  /**
+   * Invokes an Instance method from the method table.
+   *
+   * RETURNS: a JniResult object
+   */
+  static JniResult InvokeMethod(
+      JNIEnv *env,            /* The JNIEnv pointer */
+      jobject instObj,        /* The object to invoke the method on. */
+      JniMethodId methodId,   /* The method to invoke */
+      ...);  /* the method arguments */
+
   /**
    * Invokes an Instance method.
    *
@@ -245,6 +333,22 @@ public:
       jobject obj = NULL);
 
 private:
+  /**
+   * Resolves every entry of the method table, and loads the classes the
+   * proxies use on the Java side only, so that the first request loads
+   * none. Called once the JVM is attached for the first time, entries which
+   * fail to resolve here are retried when first invoked.
+   */
+  static void InitMethodTable(JNIEnv *env);
+
+  static JniResult CallMethodV(
+      JNIEnv *env,
+      jclass cls,
+      jmethodID method,
+      char returnType,
+      va_list args,
+      jobject instObj);
+
   static JniResult InvokeMethodInternal(
       JNIEnv *env,
       const char *className,
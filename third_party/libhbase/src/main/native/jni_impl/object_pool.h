@@ -0,0 +1,173 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HBASE_JNI_IMPL_OBJECT_POOL_H_
+#define HBASE_JNI_IMPL_OBJECT_POOL_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "hbase_macros.h"
+
+namespace hbase {
+
+/**
+ * Free list of recycled objects of class T, so that a request reuses the
+ * shells of earlier ones instead of going to the allocator.
+ *
+ * Each thread keeps up to THREAD_CAPACITY objects of its own and trades them
+ * with a shared list, under a lock, BATCH at a time. Objects beyond
+ * SHARED_CAPACITY are deleted, and the cache of a thread moves to the shared
+ * list when the thread exits. T links its free objects through a
+ * 'T *nextFree_' member and declares ObjectPool<T> a friend.
+ */
+template <class T>
+class ObjectPool {
+public:
+  /**
+   * @returns a recycled object, or NULL if the pool is empty.
+   */
+  static T *Take() {
+    ThreadCache *cache = GetThreadCache();
+    if (UNLIKELY(cache == NULL)) {
+      return NULL;
+    }
+    if (cache->head == NULL) {
+      pthread_mutex_lock(&mutex_);
+      for (size_t i = 0; i < BATCH && shared_ != NULL; ++i) {
+        T *object = shared_;
+        shared_ = object->nextFree_;
+        --sharedCount_;
+        Push(cache, object);
+      }
+      pthread_mutex_unlock(&mutex_);
+      if (cache->head == NULL) {
+        return NULL;
+      }
+    }
+    T *object = cache->head;
+    cache->head = object->nextFree_;
+    --cache->count;
+    object->nextFree_ = NULL;
+    return object;
+  }
+
+  /**
+   * Keeps 'object' for a later Take(), or deletes it if the pool is full.
+   */
+  static void Give(T *object) {
+    ThreadCache *cache = GetThreadCache();
+    if (UNLIKELY(cache == NULL)) {
+      delete object;
+      return;
+    }
+    if (cache->count >= THREAD_CAPACITY) {
+      Spill(cache, BATCH);
+    }
+    Push(cache, object);
+  }
+
+private:
+  static const size_t BATCH = 32;
+  static const size_t THREAD_CAPACITY = 2 * BATCH;
+  static const size_t SHARED_CAPACITY = 4096;
+
+  struct ThreadCache {
+    T *head;
+    size_t count;
+  };
+
+  static void Push(ThreadCache *cache, T *object) {
+    object->nextFree_ = cache->head;
+    cache->head = object;
+    ++cache->count;
+  }
+
+  /**
+   * Moves 'count' objects of 'cache' to the shared list.
+   */
+  static void Spill(ThreadCache *cache, size_t count) {
+    T *drop = NULL;
+    pthread_mutex_lock(&mutex_);
+    while (count-- > 0 && cache->head != NULL) {
+      T *object = cache->head;
+      cache->head = object->nextFree_;
+      --cache->count;
+      if (sharedCount_ < SHARED_CAPACITY) {
+        object->nextFree_ = shared_;
+        shared_ = object;
+        ++sharedCount_;
+      } else {
+        object->nextFree_ = drop;
+        drop = object;
+      }
+    }
+    pthread_mutex_unlock(&mutex_);
+
+    while (drop != NULL) {
+      T *object = drop;
+      drop = object->nextFree_;
+      delete object;
+    }
+  }
+
+  static void CreateKey() {
+    keyCreated_ = (pthread_key_create(&key_, ReleaseThreadCache) == 0);
+  }
+
+  static ThreadCache *GetThreadCache() {
+    pthread_once(&once_, CreateKey);
+    if (UNLIKELY(!keyCreated_)) {
+      return NULL;
+    }
+    ThreadCache *cache = static_cast<ThreadCache *>(pthread_getspecific(key_));
+    if (UNLIKELY(cache == NULL)) {
+      cache = new ThreadCache();
+      cache->head = NULL;
+      cache->count = 0;
+      if (pthread_setspecific(key_, cache) != 0) {
+        delete cache;
+        return NULL;
+      }
+    }
+    return cache;
+  }
+
+  static void ReleaseThreadCache(void *arg) {
+    ThreadCache *cache = static_cast<ThreadCache *>(arg);
+    Spill(cache, cache->count);
+    delete cache;
+  }
+
+  static pthread_once_t once_;
+  static pthread_key_t key_;
+  static bool keyCreated_;
+  static pthread_mutex_t mutex_;
+  static T *shared_;
+  static size_t sharedCount_;
+};
+
+template <class T> pthread_once_t ObjectPool<T>::once_ = PTHREAD_ONCE_INIT;
+template <class T> pthread_key_t ObjectPool<T>::key_;
+template <class T> bool ObjectPool<T>::keyCreated_ = false;
+template <class T> pthread_mutex_t ObjectPool<T>::mutex_ = PTHREAD_MUTEX_INITIALIZER;
+template <class T> T *ObjectPool<T>::shared_ = NULL;
+template <class T> size_t ObjectPool<T>::sharedCount_ = 0;
+
+} /* namespace hbase */
+
+#endif /* HBASE_JNI_IMPL_OBJECT_POOL_H_ */
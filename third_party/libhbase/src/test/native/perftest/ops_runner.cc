@@ -157,6 +157,7 @@ OpsRunner::SendPut(uint64_t row) {
   hb_mutation_set_table(put, (const char *)table_->buffer, table_->length);
   hb_mutation_set_bufferable(put, bufferPuts_);
   hb_mutation_set_durability(put, (writeToWAL_ ? DURABILITY_USE_DEFAULT : DURABILITY_SKIP_WAL));
+  hb_mutation_set_direct_buffers(put, directBuffers_);
 
   cell_data_t *cell_data = new_cell_data();
   rowSpec->first_cell = cell_data;
@@ -43,6 +43,7 @@ public:
       const bool hashKeys,
       const bool bufferPuts,
       const bool writeToWAL,
+      const bool directBuffers,
       int32_t maxPendingRPCsPerThread,
       const bool checkRead,
       StatKeeper *statKeeper) :
@@ -53,6 +54,7 @@ public:
         hashKeys_(hashKeys),
         bufferPuts_(bufferPuts),
         writeToWAL_(writeToWAL),
+        directBuffers_(directBuffers),
         family_(family),
         column_(column),
         keyPrefix_(keyPrefix),
@@ -82,6 +84,7 @@ protected:
   const bool hashKeys_;
   const bool bufferPuts_;
   const bool writeToWAL_;
+  const bool directBuffers_;
   const bytebuffer family_;
   const bytebuffer column_;
   const char *keyPrefix_;
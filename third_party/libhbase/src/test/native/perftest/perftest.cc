@@ -49,6 +49,8 @@ static bool argCheckRead   = false;
 static bool argHashKeys    = true;
 static bool argBufferPuts  = true;
 static bool argWriteToWAL  = true;
+static bool argJniBench    = false;
+static bool argDirectBuffers = false;
 
 static char *argZkQuorum    = (char*) "localhost:2181";
 static char *argZkRootNode  = NULL;
@@ -85,6 +87,8 @@ void usage() {
       "  -numThreads <num_threads> [1]\n"
       "  -putPercent <put_percent> [100]\n"
       "  -createTable true|false [false]\n"
+      "  -directBuffers true|false [false]\n"
+      "  -jniBench true|false [false]\n"
       "  -logFilePath <log_file_path> [stderr]\n");
   exit(1);
 }
@@ -110,6 +114,12 @@ parseArgs(int argc,
       argKeyPrefix = argv[1];
     } else if (ArgEQ("-createTable")) {
       argCreateTable = !(strcmp(argv[1], "false") == 0);
+    } else if (ArgEQ("-jniBench")) {
+      // measures the JNI call overhead of building gets,
+      // no cluster is contacted
+      argJniBench = !(strcmp(argv[1], "false") == 0);
+    } else if (ArgEQ("-directBuffers")) {
+      argDirectBuffers = !(strcmp(argv[1], "false") == 0);
     } else if (ArgEQ("-checkRead")) {
       argCheckRead = !(strcmp(argv[1], "false") == 0);
     } else if (ArgEQ("-hashKeys")) {
@@ -152,6 +162,91 @@ parseArgs(int argc,
   exit(1);
 }
 
+/**
+ * Builds and destroys 'numOps' gets. Each iteration creates one GetProxy and
+ * invokes three methods on it, so the reported per-call cost is dominated by
+ * the JNI method dispatch in libhbase.
+ *
+ * Then builds and destroys 'numOps' puts with one 'valueSize' byte value
+ * each, which measures the cost of handing values to the JVM with or
+ * without '-directBuffers'.
+ */
+static int32_t
+runJniBench(bytebuffer table,
+            bytebuffer family,
+            bytebuffer column) {
+  const uint64_t warmupOps = 10000;
+  const uint32_t callsPerOp = 4;
+  uint64_t startTime = 0;
+  char rowkey[64];
+
+  for (uint64_t i = 0; i < warmupOps + argNumOps; ++i) {
+    if (i == warmupOps) {
+      startTime = currentTimeMicroSeconds();
+    }
+    int len = snprintf(rowkey, sizeof(rowkey), "%s%" PRIu64, argKeyPrefix, i);
+    hb_get_t get = NULL;
+    int32_t retCode = hb_get_create((const byte_t *)rowkey, len, &get);
+    if (retCode == 0) {
+      retCode = hb_get_set_table(get, (const char *)table->buffer, table->length);
+    }
+    if (retCode == 0) {
+      retCode = hb_get_add_column(get, family->buffer, family->length,
+          column->buffer, column->length);
+    }
+    if (retCode == 0) {
+      retCode = hb_get_set_num_versions(get, 1);
+    }
+    if (get) {
+      hb_get_destroy(get);
+    }
+    if (retCode != 0) {
+      HBASE_LOG_ERROR("JNI benchmark failed : errorCode = %d.", retCode);
+      return retCode;
+    }
+  }
+
+  uint64_t elapsed = currentTimeMicroSeconds() - startTime;
+  fprintf(stdout, "JNI benchmark: %" PRIu64 " gets in %" PRIu64 " us, "
+      "%.1f ns/get, %.1f ns/call\n", argNumOps, elapsed,
+      (elapsed * 1000.0) / argNumOps,
+      (elapsed * 1000.0) / (argNumOps * callsPerOp));
+
+  bytebuffer value = bytebuffer_random(argValueSize);
+  for (uint64_t i = 0; i < warmupOps + argNumOps; ++i) {
+    if (i == warmupOps) {
+      startTime = currentTimeMicroSeconds();
+    }
+    int len = snprintf(rowkey, sizeof(rowkey), "%s%" PRIu64, argKeyPrefix, i);
+    hb_put_t put = NULL;
+    int32_t retCode = hb_put_create((const byte_t *)rowkey, len, &put);
+    if (retCode == 0) {
+      retCode = hb_mutation_set_direct_buffers(put, argDirectBuffers);
+    }
+    if (retCode == 0) {
+      retCode = hb_put_add_column(put, family->buffer, family->length,
+          column->buffer, column->length, value->buffer, value->length);
+    }
+    if (put) {
+      hb_mutation_destroy(put);
+    }
+    if (retCode != 0) {
+      HBASE_LOG_ERROR("JNI benchmark failed : errorCode = %d.", retCode);
+      bytebuffer_free(value);
+      return retCode;
+    }
+  }
+  bytebuffer_free(value);
+
+  elapsed = currentTimeMicroSeconds() - startTime;
+  fprintf(stdout, "JNI benchmark: %" PRIu64 " puts of %" PRIu32 " bytes "
+      "(directBuffers=%s) in %" PRIu64 " us, %.1f ns/put, %.1f MB/s\n",
+      argNumOps, argValueSize, argDirectBuffers ? "true" : "false", elapsed,
+      (elapsed * 1000.0) / argNumOps,
+      ((double)argNumOps * argValueSize) / (elapsed ? elapsed : 1));
+  return 0;
+}
+
 /**
  * Program entry point
  */
@@ -193,6 +288,11 @@ main(int argc,
     hb_log_set_stream(logFile); // defaults to stderr
   }
 
+  if (argJniBench) {
+    retCode = runJniBench(table, families[0], column);
+    goto cleanup;
+  }
+
   if ((retCode = hb_connection_create(argZkQuorum, argZkRootNode, &connection))) {
     HBASE_LOG_ERROR("Could not create HBase connection : errorCode = %d.", retCode);
     goto cleanup;
@@ -224,7 +324,7 @@ main(int argc,
       runner[i] = new OpsRunner(client, table, argPutPercent,
           (argStartRow + (i*opsPerThread)), opsPerThread,
           families[0], column, argKeyPrefix, argValueSize,
-          argHashKeys, argBufferPuts, argWriteToWAL,
+          argHashKeys, argBufferPuts, argWriteToWAL, argDirectBuffers,
           maxPendingRPCsPerThread, argCheckRead, statKeeper);
       runner[i]->Start();
     }
@@ -587,9 +587,20 @@ get_callback(
   if (status == 0) {
     hb_result_get_cell_count(result, &cell_count);
     hb_result_get_table(result, &table_name, &table_name_len);
+    // the key and the table name are read before the cells, which must
+    // not move them
+    const byte_t *key;
+    size_t key_len;
+    hb_result_get_key(result, &key, &key_len);
     const hb_cell_t **cells;
     hb_result_get_cells(result, &cells, &cell_count);
     HBASE_LOG_INFO("cell count:%d", cell_count);
+    if (key_len != row_data->key_->length
+        || memcmp(key, row_data->key_->buffer, key_len) != 0
+        || (cell_count > 0 && cells[0]->row != key)) {
+      HBASE_LOG_INFO("result key changed after reading the cells");
+      ret_get_row = MISMATCH_RESULT_KEY;
+    }
     if (expectedNumberOfCellCount != 0 && cell_count != expectedNumberOfCellCount) {
       HBASE_LOG_INFO("expected cell count:%ld actual result count:%ld",
           expectedNumberOfCellCount, cell_count);
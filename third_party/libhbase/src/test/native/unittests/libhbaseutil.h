@@ -32,6 +32,7 @@
 #define MISMATCH_RECEIVED_CELL_COUNT 0xFF13
 #define MISMATCH_RECEIVED_ROW_COUNT 0xFF14
 #define MISMATCH_MAX_ROW_COUNT 0xFF15
+#define MISMATCH_RESULT_KEY 0xFF16
 
 #define HBASE_MSG_LEN 1024
 
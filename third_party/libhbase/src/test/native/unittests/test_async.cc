@@ -302,6 +302,29 @@ TEST_F (HbaseCAPI, get_entire_row_async) {
   EXPECT_EQ(0, getVerifyRow(table_name, "row1", row_data, true, false));
 }
 
+TEST_F (HbaseCAPI, get_large_row_async) {
+  std::string table_name = "get_large_row";
+
+  HBASE_LOG_INFO("*** hbase table get row larger than the result buffer test ***");
+  std::vector<std::string> columnFamilies { "testcf1", "testcf2" };
+  std::string value(1024, 'v');
+  std::vector<std::string> row_data {
+    "testcf1:col1:" + value, "testcf1:col2:" + value, "testcf2:col1:" + value };
+
+  HBASE_LOG_INFO("creating table for get request:%s ", table_name.c_str());
+  ASSERT_EQ(deleteTableIfExists((char*)table_name.c_str()), 0);
+  ASSERT_EQ(createTable((char*)table_name.c_str(), columnFamilies), 0);
+  EXPECT_EQ(0, putRow(table_name, "row1", row_data));
+  HBASE_LOG_INFO("wait for puts..");
+  ASSERT_TRUE(waitForPutsToComplete());
+
+  HBASE_LOG_INFO("wait for puts completed");
+  // the first get grows the buffers of a fresh result, the second one
+  // those of a recycled result
+  EXPECT_EQ(0, getVerifyRow(table_name, "row1", row_data, true, false));
+  EXPECT_EQ(0, getVerifyRow(table_name, "row1", row_data, true, false));
+}
+
 TEST_F (HbaseCAPI, verify_cf_ttl_async) {
   std::string table_name = "test_ttl";
 
@@ -0,0 +1,212 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "timer.h"
+
+#line __LINE__ "timer.c"
+
+static hedis_timer_t **heap = NULL;
+static size_t heap_size = 0;
+static size_t heap_capacity = 0;
+
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static int timer_start_error = 0;
+static pthread_t timer_thread;
+static pthread_cond_t timer_cv;
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t
+now_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void
+place(hedis_timer_t *timer, size_t index) {
+    heap[index] = timer;
+    timer->index = index;
+}
+
+static void
+sift_up(size_t index) {
+    hedis_timer_t *timer = heap[index];
+
+    while (index > 0 && heap[(index - 1) / 2]->due > timer->due) {
+        place(heap[(index - 1) / 2], index);
+        index = (index - 1) / 2;
+    }
+
+    place(timer, index);
+}
+
+static void
+sift_down(size_t index) {
+    hedis_timer_t *timer = heap[index];
+
+    for (;;) {
+        size_t child = index * 2 + 1;
+
+        if (child >= heap_size) {
+            break;
+        }
+
+        if (child + 1 < heap_size && heap[child + 1]->due < heap[child]->due) {
+            child++;
+        }
+
+        if (heap[child]->due >= timer->due) {
+            break;
+        }
+
+        place(heap[child], index);
+        index = child;
+    }
+
+    place(timer, index);
+}
+
+static void
+remove_at(size_t index) {
+    heap[index]->index = TIMER_IDLE;
+
+    if (--heap_size == index) {
+        return;
+    }
+
+    place(heap[heap_size], index);
+
+    if (index > 0 && heap[(index - 1) / 2]->due > heap[index]->due) {
+        sift_up(index);
+    } else {
+        sift_down(index);
+    }
+}
+
+static void *
+timer_run(void *arg) {
+    pthread_mutex_lock(&timer_mutex);
+
+    for (;;) {
+        if (heap_size == 0) {
+            pthread_cond_wait(&timer_cv, &timer_mutex);
+            continue;
+        }
+
+        hedis_timer_t *timer = heap[0];
+        uint64_t now = now_ns();
+
+        if (timer->due > now) {
+            struct timespec deadline;
+
+            deadline.tv_sec = timer->due / 1000000000;
+            deadline.tv_nsec = timer->due % 1000000000;
+            pthread_cond_timedwait(&timer_cv, &timer_mutex, &deadline);
+            continue;
+        }
+
+        remove_at(0);
+
+        pthread_mutex_unlock(&timer_mutex);
+        timer->run(timer);
+        pthread_mutex_lock(&timer_mutex);
+    }
+
+    return NULL;
+}
+
+static void
+timer_start() {
+    pthread_condattr_t attr;
+
+    // due times are monotonic, so a wall clock step cannot delay them
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cv, &attr);
+    pthread_condattr_destroy(&attr);
+
+    timer_start_error = pthread_create(&timer_thread, NULL, timer_run, NULL);
+}
+
+void
+timer_init(hedis_timer_t *timer) {
+    timer->index = TIMER_IDLE;
+}
+
+int
+timer_add(hedis_timer_t *timer, uint64_t due, void (*run)(hedis_timer_t *timer)) {
+    pthread_once(&timer_once, timer_start);
+
+    if (timer_start_error != 0) {
+        return timer_start_error;
+    }
+
+    pthread_mutex_lock(&timer_mutex);
+
+    if (heap_size == heap_capacity) {
+        size_t capacity = heap_capacity ? heap_capacity * 2 : 64;
+        hedis_timer_t **grown = realloc(heap, capacity * sizeof(hedis_timer_t *));
+
+        if (grown == NULL) {
+            pthread_mutex_unlock(&timer_mutex);
+
+            return ENOMEM;
+        }
+
+        heap = grown;
+        heap_capacity = capacity;
+    }
+
+    timer->due = due;
+    timer->run = run;
+    heap[heap_size] = timer;
+    sift_up(heap_size++);
+
+    // only a new earliest timer changes how long the thread sleeps
+    if (timer->index == 0) {
+        pthread_cond_signal(&timer_cv);
+    }
+
+    pthread_mutex_unlock(&timer_mutex);
+
+    return 0;
+}
+
+bool
+timer_cancel(hedis_timer_t *timer) {
+    bool cancelled = false;
+
+    pthread_mutex_lock(&timer_mutex);
+
+    if (timer->index != TIMER_IDLE) {
+        remove_at(timer->index);
+        cancelled = true;
+    }
+
+    pthread_mutex_unlock(&timer_mutex);
+
+    return cancelled;
+}
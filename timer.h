@@ -0,0 +1,74 @@
+/**
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements. See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership. The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License. You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef HEDIS_CONNECTOR_TIMER_H_
+#define HEDIS_CONNECTOR_TIMER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * One-shot timers, run in due order by a single timer thread.
+ *
+ * Timers are kept in a binary heap, so arming and cancelling one costs
+ * O(log n) under one lock whatever the number armed. The thread is started
+ * by the first timer_add(). A timer is owned by its caller and usually
+ * embedded in a request; it must stay valid until it has run or
+ * timer_cancel() has removed it.
+ */
+typedef struct hedis_timer_t_ {
+    uint64_t due;               /* CLOCK_MONOTONIC, in nanoseconds */
+    size_t index;               /* position in the heap, or TIMER_IDLE */
+    void (*run)(struct hedis_timer_t_ *timer);
+} hedis_timer_t;
+
+#define TIMER_IDLE SIZE_MAX
+
+/**
+ * Marks a timer as not armed.
+ */
+void
+timer_init(hedis_timer_t *timer);
+
+/**
+ * Arms 'timer' to run 'run' on the timer thread at 'due', a stats_now()
+ * timestamp. 'run' must not block.
+ *
+ * @returns 0 on success, ENOMEM or the error of pthread_create()
+ */
+int
+timer_add(hedis_timer_t *timer, uint64_t due, void (*run)(hedis_timer_t *timer));
+
+/**
+ * Disarms 'timer'.
+ *
+ * @returns true if it was removed before running, false if it was not armed
+ * or is already running.
+ */
+bool
+timer_cancel(hedis_timer_t *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEDIS_CONNECTOR_TIMER_H_ */